@@ -0,0 +1,402 @@
+#define LOG_TAG "AnalysisPipeline"
+
+#include "AnalysisPipeline.h"
+#include "DspLog.h"
+#include "TraceRing.h"
+#include <sched.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+
+int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+size_t AnalysisPipeline::arenaBytes(int fftSize) {
+    return SpectrumAnalyzer::arenaBytes(fftSize) + SpectrumAnalyzer::arenaBytes(fftSize, kAnalyzerFixedFft)
+           + DspArena::alignUp(fftSize * sizeof(float)) + DspArena::alignUp(fftSize * sizeof(int16_t));
+}
+
+AnalysisPipeline::AnalysisPipeline(const SpectrumAnalyzerConfig& config)
+        : arena(arenaBytes(config.fftSize)),
+          fftAnalyzer(config, &arena),
+          fixedAnalyzer(config, &arena, kAnalyzerFixedFft),
+          envelopeAnalyzer(config),
+          activeAnalyzer(&fftAnalyzer),
+          requestedAnalyzer(kAnalyzerFft),
+          hopStartNs(0),
+          chainConfig(config),
+          chainFftSize(0),
+          requestedHopSize(config.hopSize),
+          burstFrames(1),
+          vehicleSpeed(-1.0f),
+          resetRequested(false),
+          beatEvents(64), // Several seconds of beats and onsets between polls
+          captureFormat(kCaptureFloat),
+          pcmRing(4 * SpectrumAnalyzer::kMaxFftSize), // Room for any FFT size configure() picks
+          pcm16Ring(4 * SpectrumAnalyzer::kMaxFftSize),
+          workerScratch(nullptr),
+          workerScratch16(nullptr),
+          analysisMode(kAnalysisInline),
+          workerPriority(-16),
+          workerCpuMask(0),
+          lastRingWriteNs(0),
+          callbackLastNs(0),
+          callbackMaxNs(0),
+          ringOverrunSamples(0),
+          workerLagLastNs(0),
+          workerLagMaxNs(0),
+          noFreshPolls(0),
+          staleReads(0),
+          firstPublishNs(0),
+          inputGainMilli(0),
+          hopSizeInUse(0) {
+    workerScratch = arena.carve<float>(config.fftSize);
+    workerScratch16 = arena.carve<int16_t>(config.fftSize);
+    reset(true);
+}
+
+AnalysisPipeline::~AnalysisPipeline() {
+    stopWorker();
+}
+
+void AnalysisPipeline::onAudio(const float* input, int32_t totalSamples) {
+    capture(input, totalSamples, pcmRing);
+}
+
+void AnalysisPipeline::onAudio(const int16_t* input, int32_t totalSamples) {
+    capture(input, totalSamples, pcm16Ring);
+}
+
+template <typename Sample>
+void AnalysisPipeline::capture(const Sample* input, int32_t totalSamples, SpscRingBuffer<Sample>& ring) {
+    int64_t startNs = nowNanos();
+
+    int mode = analysisMode.load(std::memory_order_acquire);
+    if (mode == kAnalysisWorkerRequested) {
+        int expected = kAnalysisWorkerRequested;
+        if (analysisMode.compare_exchange_strong(expected, kAnalysisWorker, std::memory_order_acq_rel)) {
+            mode = kAnalysisWorker;
+        } else {
+            mode = expected;
+        }
+    }
+
+    if (mode == kAnalysisInline) {
+        analyzeSamples(input, totalSamples);
+    } else {
+        // The worker owns the analysis state; only hand it the raw PCM
+        uint32_t written = ring.write(input, static_cast<uint32_t>(totalSamples));
+        if (written < static_cast<uint32_t>(totalSamples)) {
+            ringOverrunSamples.fetch_add(totalSamples - written, std::memory_order_relaxed);
+            DSP_TRACE(kTraceRingOverrun, static_cast<float>(totalSamples - written), static_cast<float>(ring.capacity()));
+        }
+        lastRingWriteNs.store(startNs, std::memory_order_release);
+        ringWritten.post();
+    }
+
+    int64_t elapsedNs = nowNanos() - startNs;
+    callbackLastNs.store(elapsedNs, std::memory_order_relaxed);
+    if (elapsedNs > callbackMaxNs.load(std::memory_order_relaxed)) {
+        callbackMaxNs.store(elapsedNs, std::memory_order_relaxed);
+    }
+    histograms[kHistCallbackNs].record(elapsedNs);
+    histograms[kHistBurstFrames].record(totalSamples);
+}
+
+// Runs on whichever thread currently owns the analysis state (see AnalysisMode)
+template <typename Sample>
+void AnalysisPipeline::analyzeSamples(const Sample* input, int32_t totalSamples) {
+    if (chainUpdates.consume()) {
+        // Every analyzer, so a later switch keeps the chain
+        fftAnalyzer.retune(chainUpdates.front());
+        fixedAnalyzer.retune(chainUpdates.front());
+        envelopeAnalyzer.retune(chainUpdates.front());
+    }
+    int kind = requestedAnalyzer.load(std::memory_order_relaxed);
+    if (kind != activeAnalyzer->getKind()) {
+        activeAnalyzer = kind == kAnalyzerEnvelope ? static_cast<BandAnalyzer*>(&envelopeAnalyzer)
+                         : kind == kAnalyzerFixedFft ? static_cast<BandAnalyzer*>(&fixedAnalyzer)
+                         : &fftAnalyzer;
+        activeAnalyzer->reset(); // Drop history from the last time it was active
+        beatTracker.reset();
+    }
+    if (resetRequested.exchange(false, std::memory_order_acquire)) {
+        activeAnalyzer->reset();
+        beatTracker.reset();
+    }
+    int hopSize = effectiveHopSize(requestedHopSize.load(std::memory_order_relaxed));
+    if (hopSize != activeAnalyzer->getHopSize()) {
+        activeAnalyzer->setHopSize(hopSize);
+    }
+    hopSizeInUse.store(activeAnalyzer->getHopSize(), std::memory_order_relaxed);
+    activeAnalyzer->setVehicleSpeed(vehicleSpeed.load(std::memory_order_relaxed));
+
+    hopStartNs = nowNanos();
+    activeAnalyzer->analyze(input, totalSamples, *this);
+}
+
+// Analysed straight into the back slot; publishing never blocks on the reader
+void AnalysisPipeline::publishFrame() {
+    SpectrumFrame& frame = spectrum.back();
+    int64_t hopEndNs = nowNanos();
+    histograms[kHistHopAnalysisNs].record(hopEndNs - hopStartNs);
+    hopStartNs = hopEndNs;
+
+    const float hopSeconds = activeAnalyzer->getHopSize() / fftAnalyzer.getConfig().sampleRate;
+    BeatEvent events[BeatTracker::kMaxEventsPerHop];
+    int eventCount = beatTracker.process(frame.onsetStrength, hopSeconds, hopEndNs, events, &frame.bands.beatPhase);
+    const bool shared = sharedSpectrum.isRegistered();
+    if (eventCount > 0 && !shared) {
+        beatEvents.write(events, static_cast<uint32_t>(eventCount)); // pollBeatEvents, without the shared buffer
+    }
+
+    inputGainMilli.store(static_cast<int64_t>(activeAnalyzer->getInputGain() * 1000.0f), std::memory_order_relaxed);
+    frame.publishedNs = hopEndNs;
+    spectrum.publish();
+    if (firstPublishNs.load(std::memory_order_relaxed) == 0) {
+        firstPublishNs.store(hopEndNs, std::memory_order_release);
+    }
+    if (shared) {
+        sharedSpectrum.publish(frame.bands, frame.lowFreqMagnitude, frame.highFreqMagnitude, 0.0f, 1000.0f, events,
+                               eventCount);
+    }
+}
+
+bool AnalysisPipeline::consume() {
+    bool fresh = spectrum.consume();
+    if (!fresh) {
+        noFreshPolls.store(noFreshPolls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    int64_t publishedNs = spectrum.front().publishedNs;
+    if (publishedNs > 0) {
+        int64_t ageNs = nowNanos() - publishedNs;
+        histograms[kHistFrameAgeNs].record(ageNs);
+        if (ageNs > kStaleFrameNs) {
+            staleReads.store(staleReads.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+    return fresh;
+}
+
+bool AnalysisPipeline::configure(float sampleRate, int framesPerBurst, CaptureFormat format) {
+    bool workerWasRunning = analysisThread.joinable();
+    stopWorker();
+
+    SpectrumAnalyzerConfig config = chainConfig;
+    config.sampleRate = sampleRate;
+    config.fftSize = chainFftSize ? chainFftSize : SpectrumAnalyzer::fftSizeForSampleRate(sampleRate);
+    burstFrames = std::max(1, std::min(framesPerBurst, config.fftSize));
+    config.hopSize = effectiveHopSize(std::min(requestedHopSize.load(std::memory_order_relaxed), config.fftSize));
+    // Same layout as before unless the FFT size grew, so a warm restart allocates nothing
+    bool configured = arena.reset(arenaBytes(config.fftSize));
+    if (!configured) {
+        LOGE("Failed to allocate %zu bytes of analysis buffers", arenaBytes(config.fftSize));
+    }
+    // Every analyzer is configured even after a failure, so none keeps pointers into the old layout
+    configured = fftAnalyzer.configure(config) && configured;
+    configured = fixedAnalyzer.configure(config) && configured;
+    configured = envelopeAnalyzer.configure(config) && configured;
+    workerScratch = arena.carve<float>(config.fftSize);
+    workerScratch16 = arena.carve<int16_t>(config.fftSize);
+    captureFormat = format;
+    if (!configured || !workerScratch || !workerScratch16) {
+        LOGE("Analysis not configured for %.0f Hz, fftSize=%d", sampleRate, config.fftSize);
+        return false;
+    }
+    reset(true);
+    LOGI("Analysis configured for %.0f Hz %s, %d-frame bursts: fftSize=%d, hop=%d",
+         sampleRate, format == kCaptureI16 ? "I16" : "float", framesPerBurst, config.fftSize, config.hopSize);
+
+    if (workerWasRunning) {
+        startWorker(workerPriority, workerCpuMask);
+    }
+    return true;
+}
+
+// Hops shorter than a burst would publish several frames per callback with
+// the same timestamp, of which the poller only ever sees the last
+int AnalysisPipeline::effectiveHopSize(int hopSize) const {
+    return std::max(hopSize, burstFrames);
+}
+
+void AnalysisPipeline::setHopSize(int hopSize) {
+    hopSize = std::max(1, std::min(hopSize, fftAnalyzer.getFftSize()));
+    requestedHopSize.store(hopSize, std::memory_order_relaxed);
+    LOGI("STFT hop size set to %d samples", hopSize);
+}
+
+bool AnalysisPipeline::setChain(const float* descriptor, int length) {
+    SpectrumAnalyzerConfig config = chainConfig;
+    int fftSize = 0;
+    if (!parseChainDescriptor(descriptor, length, config, &fftSize)) {
+        return false;
+    }
+    chainConfig = config;
+    chainUpdates.back() = config;
+    chainUpdates.publish();
+    if (fftSize != chainFftSize) {
+        chainFftSize = fftSize;
+        LOGI("Chain FFT size %d takes effect when the stream is next opened", fftSize);
+    }
+    LOGI("Chain set: stages=0x%x gain=%.2f agc=%.1f dBFS %.2f/%.2f s window=%d sens=%.1f/%.1f cap=%.1f smoothing=%.2f "
+         "noise=%.2f+%.2f floor=%.2f",
+         config.stages, config.gain, config.agcTargetDbfs, config.agcAttackSeconds, config.agcReleaseSeconds,
+         config.window, config.lowSensitivity, config.highSensitivity, config.magnitudeCap, config.smoothing,
+         config.noiseOversubtraction, config.noiseSpeedOversubtraction, config.noiseSpectralFloor);
+    return true;
+}
+
+void AnalysisPipeline::setVehicleSpeed(float metersPerSecond) {
+    vehicleSpeed.store(metersPerSecond, std::memory_order_relaxed);
+}
+
+bool AnalysisPipeline::setAnalyzer(int kind) {
+    if (kind < 0 || kind >= kAnalyzerKindCount) {
+        LOGE("Unknown analyzer kind %d", kind);
+        return false;
+    }
+    requestedAnalyzer.store(kind, std::memory_order_relaxed);
+    LOGI("Analyzer set to %s", kind == kAnalyzerEnvelope ? "envelope" : kind == kAnalyzerFixedFft ? "fixed" : "fft");
+    return true;
+}
+
+CaptureFormat AnalysisPipeline::getPreferredCaptureFormat() const {
+    return requestedAnalyzer.load(std::memory_order_relaxed) == kAnalyzerFixedFft ? kCaptureI16 : kCaptureFloat;
+}
+
+void AnalysisPipeline::reset(bool producerIdle) {
+    if (!producerIdle || analysisMode.load(std::memory_order_acquire) != kAnalysisInline) {
+        // The analysing thread owns the producer side; let it clear its own history
+        resetRequested.store(true, std::memory_order_release);
+        LOGI("Buffer reset requested from running stream");
+        return;
+    }
+    // The poller may be reading the front slot right now, so the stale spectrum
+    // is replaced through the producer side rather than by resetting the buffer
+    spectrum.back() = SpectrumFrame{};
+    spectrum.publish();
+    activeAnalyzer->reset();
+    beatTracker.reset();
+    resetRequested.store(false, std::memory_order_relaxed);
+    firstPublishNs.store(0, std::memory_order_relaxed);
+    LOGI("Buffers reset");
+}
+
+int AnalysisPipeline::pollBeatEvents(BeatEvent* events, int maxEvents) {
+    return static_cast<int>(beatEvents.read(events, static_cast<uint32_t>(std::max(maxEvents, 0))));
+}
+
+void* AnalysisPipeline::registerSharedSpectrum(size_t* size) {
+    *size = sharedSpectrum.size();
+    sharedSpectrum.setRegistered(true);
+    LOGI("Shared spectrum buffer registered, %zu bytes", *size);
+    return sharedSpectrum.data();
+}
+
+bool AnalysisPipeline::startWorker(int priority, uint64_t cpuMask) {
+    stopWorker();
+    workerPriority = priority;
+    workerCpuMask = cpuMask;
+    pcmRing.clear();
+    pcm16Ring.clear();
+    analysisMode.store(kAnalysisWorkerRequested, std::memory_order_release);
+    analysisThread = std::thread(&AnalysisPipeline::analysisWorkerLoop, this);
+    LOGI("Analysis worker started, priority=%d, cpuMask=0x%llx", priority, (unsigned long long) cpuMask);
+    return true;
+}
+
+void AnalysisPipeline::stopWorker() {
+    int expected = kAnalysisWorkerRequested;
+    if (!analysisMode.compare_exchange_strong(expected, kAnalysisInline, std::memory_order_acq_rel) && expected == kAnalysisWorker) {
+        analysisMode.compare_exchange_strong(expected, kAnalysisInlineRequested, std::memory_order_acq_rel);
+    }
+    ringWritten.post();
+    if (analysisThread.joinable()) {
+        analysisThread.join();
+        LOGI("Analysis worker stopped");
+    }
+}
+
+void AnalysisPipeline::analysisWorkerLoop() {
+    if (workerPriority != 0 && setpriority(PRIO_PROCESS, 0, workerPriority) != 0) {
+        LOGW("Failed to set analysis worker priority %d", workerPriority);
+    }
+    if (workerCpuMask != 0) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; cpu++) {
+            if (workerCpuMask & (1ULL << cpu)) CPU_SET(cpu, &cpuSet);
+        }
+        if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0) {
+            LOGW("Failed to set analysis worker affinity 0x%llx", (unsigned long long) workerCpuMask);
+        }
+    }
+
+    const uint32_t chunk = static_cast<uint32_t>(fftAnalyzer.getFftSize());
+    while (true) {
+        int mode = analysisMode.load(std::memory_order_acquire);
+        if (mode == kAnalysisInline) {
+            break;
+        }
+        if (mode == kAnalysisInlineRequested) {
+            analysisMode.store(kAnalysisInline, std::memory_order_release);
+            break;
+        }
+        const bool i16 = captureFormat == kCaptureI16;
+        if (mode != kAnalysisWorker || (i16 ? pcm16Ring.availableToRead() : pcmRing.availableToRead()) == 0) {
+            // Until the callback's next write; the timeout only matters once the stream stops
+            ringWritten.wait(kWorkerIdleWaitNs);
+            continue;
+        }
+
+        int64_t newestWriteNs = lastRingWriteNs.load(std::memory_order_acquire);
+        if (i16) {
+            uint32_t count = pcm16Ring.read(workerScratch16, chunk);
+            analyzeSamples(workerScratch16, static_cast<int32_t>(count));
+        } else {
+            uint32_t count = pcmRing.read(workerScratch, chunk);
+            analyzeSamples(workerScratch, static_cast<int32_t>(count));
+        }
+
+        int64_t lagNs = nowNanos() - newestWriteNs;
+        workerLagLastNs.store(lagNs, std::memory_order_relaxed);
+        if (lagNs > workerLagMaxNs.load(std::memory_order_relaxed)) {
+            workerLagMaxNs.store(lagNs, std::memory_order_relaxed);
+        }
+    }
+}
+
+void AnalysisPipeline::getStats(int64_t* stats, int count) const {
+    const int64_t values[kStatCount] = {
+            callbackLastNs.load(std::memory_order_relaxed),
+            callbackMaxNs.load(std::memory_order_relaxed),
+            workerLagLastNs.load(std::memory_order_relaxed),
+            workerLagMaxNs.load(std::memory_order_relaxed),
+            ringOverrunSamples.load(std::memory_order_relaxed),
+            analysisMode.load(std::memory_order_relaxed),
+            requestedAnalyzer.load(std::memory_order_relaxed),
+            inputGainMilli.load(std::memory_order_relaxed),
+            hopSizeInUse.load(std::memory_order_relaxed),
+    };
+    for (int i = 0; i < count && i < kStatCount; i++) {
+        stats[i] = values[i];
+    }
+}
+
+void AnalysisPipeline::getHistogramStats(int64_t* stats, int count) const {
+    int64_t values[kHistogramStatCount];
+    for (int h = 0; h < kHistogramCount; h++) {
+        LogHistogram::Summary summary = histograms[h].summarize();
+        values[h * 4] = summary.p50;
+        values[h * 4 + 1] = summary.p99;
+        values[h * 4 + 2] = summary.max;
+        values[h * 4 + 3] = summary.count;
+    }
+    values[kHistogramCount * 4] = noFreshPolls.load(std::memory_order_relaxed);
+    values[kHistogramCount * 4 + 1] = staleReads.load(std::memory_order_relaxed);
+    for (int i = 0; i < count && i < kHistogramStatCount; i++) {
+        stats[i] = values[i];
+    }
+}
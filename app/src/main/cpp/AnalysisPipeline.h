@@ -0,0 +1,188 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include "BeatTracker.h"
+#include "DspArena.h"
+#include "DspChain.h"
+#include "EnvelopeAnalyzer.h"
+#include "LogHistogram.h"
+#include "SharedSpectrumBuffer.h"
+#include "SpectrumAnalyzer.h"
+#include "SpscRingBuffer.h"
+#include "TripleBuffer.h"
+#include "WakeSignal.h"
+
+// Who runs the FFT. Ownership only moves through these states so the callback
+// and the analysis worker never touch the analysis buffers at the same time.
+enum AnalysisMode : int {
+    kAnalysisInline = 0,          // Callback runs the FFT itself
+    kAnalysisWorkerRequested = 1, // Worker started, callback hands over on its next burst
+    kAnalysisWorker = 2,          // Callback only copies PCM into the ring buffer
+    kAnalysisInlineRequested = 3, // Worker finishes its hop and hands back
+};
+
+// Sample format the stream was opened with. The FFT and envelope analyzers
+// take either, as does the fixed-point one; I16 spares it the conversion.
+enum CaptureFormat : int {
+    kCaptureFloat = 0,
+    kCaptureI16 = 1,
+};
+
+int64_t nowNanos();
+
+// Everything between the capture callback and the reader: analysis inline or on
+// a worker thread, the triple-buffered hand-off and the shared Kotlin buffer.
+// The capture adapter calls onAudio() from its real-time thread; every other
+// method is for the control/reader thread.
+class AnalysisPipeline : private FrameSink {
+public:
+    explicit AnalysisPipeline(const SpectrumAnalyzerConfig& config);
+    ~AnalysisPipeline();
+
+    AnalysisPipeline(const AnalysisPipeline&) = delete;
+    AnalysisPipeline& operator=(const AnalysisPipeline&) = delete;
+
+    // Real-time side: never blocks, never allocates. Call the overload for the
+    // format configure() was given.
+    void onAudio(const float* input, int32_t totalSamples);
+    void onAudio(const int16_t* input, int32_t totalSamples);
+
+    bool startWorker(int priority, uint64_t cpuMask);
+    void stopWorker();
+
+    // Re-plans the analysis for the rate and format the stream actually opened
+    // with. Call between open and start, while no callback can run; a running
+    // worker is restarted with its previous settings. False if the analysis
+    // buffers could not be allocated; the stream must not be started then.
+    bool configure(float sampleRate, int framesPerBurst, CaptureFormat format = kCaptureFloat);
+
+    // Format to open the next stream with: I16 when the fixed-point analyzer is requested
+    CaptureFormat getPreferredCaptureFormat() const;
+
+    // Hop between FFTs in samples; applied by the analysing thread at its next
+    // burst, and never shorter than the burst size configure() was given
+    void setHopSize(int hopSize);
+
+    // Switches between the FFT, fixed-point FFT and time-domain envelope
+    // analyzers (AnalyzerKind); applied by the analysing thread at its next
+    // burst. All stay configured, so this never allocates. The capture format
+    // follows at the next open.
+    bool setAnalyzer(int kind);
+
+    // Replaces the chain from a DspChain.h descriptor. Stage switches and their
+    // parameters are retuned by the analysing thread at its next burst without
+    // reallocating; a different FFT size is planned at the next configure().
+    bool setChain(const float* descriptor, int length);
+
+    // Vehicle speed from GPS in m/s, negative when unknown; the road-noise
+    // subtraction follows it from the analysing thread's next burst
+    void setVehicleSpeed(float metersPerSecond);
+
+    // Clears the analysis history. producerIdle means no callback can be running,
+    // so the reset happens immediately instead of on the analysing thread, and
+    // an empty frame is published in place of the last spectrum. Either way
+    // only the producer side is touched; the poller may keep running.
+    void reset(bool producerIdle);
+
+    // Reader side. Single consumer: call from one polling thread only.
+    // consume() also records the reader statistics below.
+    bool consume();
+    const SpectrumFrame& latest() const { return spectrum.front(); }
+
+    // Onsets and beats since the last poll, oldest first; returns how many were
+    // copied. Single consumer. Events not polled before the queue fills are dropped.
+    // Only fed until the shared buffer is registered, which carries them from then on.
+    int pollBeatEvents(BeatEvent* events, int maxEvents);
+
+    // Native memory backing the Kotlin ByteBuffer; stays valid until the pipeline is destroyed
+    void* registerSharedSpectrum(size_t* size);
+
+    // stats: [callbackLastNs, callbackMaxNs, workerLagLastNs, workerLagMaxNs, ringOverrunSamples, analysisMode, analyzer,
+    //         input gain x1000 (fixed or AGC), hop size in use (setHopSize raised to the burst size; 0 before the
+    //         first burst)]
+    static constexpr int kStatCount = 9;
+    void getStats(int64_t* stats, int count) const;
+
+    // Distributions, each filled by the one thread that measures it
+    enum Histogram {
+        kHistCallbackNs,    // onAudio() duration (capture thread)
+        kHistHopAnalysisNs, // FFT, magnitudes and bands per hop (analysing thread)
+        kHistBurstFrames,   // Samples per callback (capture thread)
+        kHistFrameAgeNs,    // Age of the newest spectrum when the reader polls (reader)
+        kHistogramCount
+    };
+    // histogramStats: [p50, p99, max, count] per Histogram, then noFreshPolls, staleReads
+    static constexpr int kHistogramStatCount = kHistogramCount * 4 + 2;
+    static constexpr int64_t kStaleFrameNs = 100000000; // Two UI polls without a new spectrum
+    void getHistogramStats(int64_t* stats, int count) const;
+
+    // nowNanos() of the first spectrum published since the last idle reset, 0 before then
+    int64_t getFirstPublishNs() const { return firstPublishNs.load(std::memory_order_acquire); }
+
+private:
+    // Analyzer buffers plus the worker's read scratch
+    static size_t arenaBytes(int fftSize);
+
+    template <typename Sample>
+    void capture(const Sample* input, int32_t totalSamples, SpscRingBuffer<Sample>& ring);
+    template <typename Sample>
+    void analyzeSamples(const Sample* input, int32_t totalSamples);
+    void analysisWorkerLoop();
+    int effectiveHopSize(int hopSize) const;
+
+    // FrameSink, called by the active analyzer for every hop
+    SpectrumFrame& beginFrame() override { return spectrum.back(); }
+    void publishFrame() override;
+
+    DspArena arena; // Declared before the FFT analyzers, which carve from it
+    SpectrumAnalyzer fftAnalyzer;
+    SpectrumAnalyzer fixedAnalyzer;
+    EnvelopeAnalyzer envelopeAnalyzer;
+    BandAnalyzer* activeAnalyzer; // Owned by the analysing thread
+    std::atomic<int> requestedAnalyzer;
+    int64_t hopStartNs;           // Analysing thread
+    SpectrumAnalyzerConfig chainConfig; // Control thread's copy of the chain settings
+    int chainFftSize;                   // From the chain descriptor, 0 = by sample rate
+    TripleBuffer<SpectrumAnalyzerConfig> chainUpdates; // Control thread -> analysing thread
+    std::atomic<int> requestedHopSize;
+    int burstFrames;                    // Set by configure() while nothing runs; the shortest hop
+    std::atomic<float> vehicleSpeed;    // Control thread -> analysing thread
+    TripleBuffer<SpectrumFrame> spectrum; // Written by the analysing thread, read by the poller
+    SharedSpectrumBuffer<SpectrumFrame::kLowFreqBins, SpectrumFrame::kHighFreqBins> sharedSpectrum;
+    std::atomic<bool> resetRequested;
+    BeatTracker beatTracker;            // Analysing thread; fills bands.beatPhase
+    SpscRingBuffer<BeatEvent> beatEvents; // Analysing thread -> beat poller
+
+    // Analysis worker; only the ring of the capture format is used
+    CaptureFormat captureFormat; // Set by configure() while nothing runs
+    SpscRingBuffer<float> pcmRing;
+    SpscRingBuffer<int16_t> pcm16Ring;
+    WakeSignal ringWritten; // Posted by the capture thread after each write, and by stopWorker()
+    static constexpr int64_t kWorkerIdleWaitNs = 100000000; // Longest worker sleep with nothing to read
+    float* workerScratch; // In arena
+    int16_t* workerScratch16;
+    std::atomic<int> analysisMode;
+    std::thread analysisThread;
+    int workerPriority;
+    uint64_t workerCpuMask;
+
+    // Counters are grouped by the thread that writes them, one cache line per
+    // group, so the capture thread never invalidates a line the worker or the
+    // poller is writing.
+    alignas(64) std::atomic<int64_t> lastRingWriteNs; // Capture thread
+    std::atomic<int64_t> callbackLastNs;
+    std::atomic<int64_t> callbackMaxNs;
+    std::atomic<int64_t> ringOverrunSamples;
+    alignas(64) std::atomic<int64_t> workerLagLastNs; // Worker
+    std::atomic<int64_t> workerLagMaxNs;
+    alignas(64) std::atomic<int64_t> noFreshPolls; // Poller
+    std::atomic<int64_t> staleReads;
+    std::atomic<int64_t> firstPublishNs; // Analysing thread, read by the control thread
+    alignas(64) std::atomic<int64_t> inputGainMilli; // Analysing thread, every hop
+    std::atomic<int64_t> hopSizeInUse;               // Analysing thread, every burst
+
+    LogHistogram histograms[kHistogramCount]; // Each cache-aligned; see LogHistogram
+};
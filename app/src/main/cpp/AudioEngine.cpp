@@ -1,21 +1,20 @@
+#define LOG_TAG "AudioEngine"
+
 #include <oboe/Oboe.h>
-#include "kissfft/kiss_fft.h"
-#include "kissfft/kiss_fftr.h"
+#include "AnalysisPipeline.h"
+#include "DspLog.h"
+#include "EngineRegistry.h"
+#include "SpectrumKernels.h"
+#include "TraceRing.h"
 #include <jni.h>
-#include <android/log.h>
-#include <pthread.h>
-#include <cmath>
-#include <thread>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
-
-#define LOG_TAG "AudioEngine"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
-#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 static JavaVM* gJavaVM = nullptr;
-static pthread_mutex_t audioMutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t audioCond = PTHREAD_COND_INITIALIZER;
 
 static JNIEnv* GetJNIEnv() {
     JNIEnv* env = nullptr;
@@ -33,50 +32,51 @@ static JNIEnv* GetJNIEnv() {
     return env;
 }
 
+// Where the engine is in its asynchronous start; polled through getEngineState
+enum EngineState : int {
+    kEngineIdle = 0,     // Not started, stopped, or start cancelled
+    kEngineStarting = 1, // Stream being opened on the start thread
+    kEngineRunning = 2,  // Stream started, callbacks flowing
+    kEngineFailed = 3,   // Open or start failed after all retries, or no memory for the analysis
+    kEnginePaused = 4,   // Stream open but stopped; resumes warm with requestStart
+    kEngineDisconnected = 5, // Device went away; the next start reopens from scratch
+};
+
+// Oboe capture adapter: owns the input stream and forwards each burst to the
+// platform-free AnalysisPipeline, which does all of the DSP work.
 class AudioEngine : public oboe::AudioStreamCallback {
 private:
-    oboe::ManagedStream inputStream;
-    kiss_fftr_cfg fftCfg;
-    kiss_fft_cpx* fftOutput;
-    float* audioBuffer;
-    const int sampleSize = 2048;
-    float* lowFreqMagnitude;
-    float* highFreqMagnitude;
-    float* lowFreqBuffer;
-    float* highFreqBuffer;
+    oboe::ManagedStream inputStream; // Owned by the start thread until the state leaves kEngineStarting
+    AnalysisPipeline pipeline;
+    TraceDrainer traceDrainer;
     JNIEnv* env;
     jobject javaObject;
-    bool dataReady;
-    bool isStreamRunning;
+    std::atomic<int> state;
+
+    // Asynchronous start
+    std::thread startThread;
+    std::mutex startMutex;
+    std::condition_variable startCancelled;
+    bool cancelStart;
+    int64_t startRequestedNs;
+    std::mutex workerMutex; // Serialises worker start/stop and chain changes with configure()
 
 public:
-    AudioEngine(JNIEnv* env, jobject obj) : env(env), javaObject(obj ? env->NewGlobalRef(obj) : nullptr), dataReady(false), isStreamRunning(false) {
+    AudioEngine(JNIEnv* env, jobject obj) : pipeline(SpectrumAnalyzerConfig()), env(env), javaObject(obj ? env->NewGlobalRef(obj) : nullptr),
+                                             state(kEngineIdle), cancelStart(false), startRequestedNs(0) {
         if (!javaObject) {
             LOGE("javaObject is null in AudioEngine constructor");
             return;
         }
-
-        fftCfg = kiss_fftr_alloc(sampleSize, 0, nullptr, nullptr);
-        fftOutput = new kiss_fft_cpx[sampleSize / 2 + 1];
-        audioBuffer = new float[sampleSize];
-        lowFreqMagnitude = new float[22];
-        highFreqMagnitude = new float[1024];
-        lowFreqBuffer = new float[22];
-        highFreqBuffer = new float[1024];
-        resetBuffers();
+        traceDrainer.start();
         LOGI("AudioEngine constructed at %p", this);
     }
 
     ~AudioEngine() {
         LOGI("Destroying AudioEngine at %p", this);
         stopStream();
-        kiss_fftr_free(fftCfg);
-        delete[] fftOutput;
-        delete[] audioBuffer;
-        delete[] lowFreqMagnitude;
-        delete[] highFreqMagnitude;
-        delete[] lowFreqBuffer;
-        delete[] highFreqBuffer;
+        stopAnalysisWorker();
+        traceDrainer.stop();
         if (javaObject) {
             JNIEnv* currentEnv = GetJNIEnv();
             if (currentEnv) {
@@ -88,56 +88,69 @@ public:
         }
     }
 
-    bool startStream() {
-        if (isStreamRunning) {
-            LOGI("Stream already running, skipping start");
-            return true;
+    // Returns immediately; the stream is started on a background thread and
+    // progress is reported through getState(). A paused engine restarts its
+    // existing stream; otherwise the stream is opened and configured first.
+    void startAsync() {
+        int current = state.load(std::memory_order_acquire);
+        if (current == kEngineStarting || current == kEngineRunning) {
+            LOGI("Stream already starting or running, skipping start");
+            return;
         }
-
-        oboe::AudioStreamBuilder builder;
-        builder.setDirection(oboe::Direction::Input)
-                ->setPerformanceMode(oboe::PerformanceMode::LowLatency)
-                ->setSampleRate(48000) // Changed to 48000 Hz, more commonly supported
-                ->setChannelCount(oboe::ChannelCount::Mono)
-                ->setFormat(oboe::AudioFormat::Float)
-                ->setCallback(this);
-
-        // Retry logic for stream opening
-        const int maxRetries = 3;
-        const int retryDelayMs = 500;
-        for (int attempt = 1; attempt <= maxRetries; attempt++) {
-            oboe::Result result = builder.openManagedStream(inputStream);
-            if (result == oboe::Result::OK) {
-                break;
-            }
-            LOGE("Attempt %d/%d: Failed to open audio stream: %s", attempt, maxRetries, oboe::convertToText(result));
-            if (attempt == maxRetries) {
-                return false;
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(retryDelayMs));
+        if (startThread.joinable()) startThread.join();
+        {
+            std::lock_guard<std::mutex> lock(startMutex);
+            cancelStart = false;
         }
+        startRequestedNs = nowNanos();
+        if (!state.compare_exchange_strong(current, kEngineStarting, std::memory_order_acq_rel)) {
+            current = kEngineDisconnected; // Disconnected meanwhile; reopen
+            state.store(kEngineStarting, std::memory_order_release);
+        }
+        startThread = std::thread(current == kEnginePaused ? &AudioEngine::restartPaused : &AudioEngine::openAndStart, this);
+    }
 
-        // Verify stream state before starting
-        if (!inputStream) {
-            LOGE("Audio stream is null after open attempt");
-            return false;
+    // Stops capture but keeps the stream, the FFT plan and every buffer for a warm resume
+    void pause() {
+        {
+            std::lock_guard<std::mutex> lock(startMutex);
+            cancelStart = true;
         }
+        startCancelled.notify_all();
+        if (startThread.joinable()) startThread.join();
 
-        oboe::Result result = inputStream->requestStart();
+        int expected = kEngineRunning;
+        if (!state.compare_exchange_strong(expected, kEnginePaused, std::memory_order_acq_rel)) {
+            LOGI("Stream not running (state %d), nothing to pause", expected);
+            return;
+        }
+        // AAudio input streams do not implement pause; stopping keeps the stream open just the same
+        oboe::Result result = inputStream->requestPause();
         if (result != oboe::Result::OK) {
-            LOGE("Failed to start audio stream: %s", oboe::convertToText(result));
-            inputStream->close();
-            return false;
+            result = inputStream->requestStop();
         }
-
-        isStreamRunning = true;
-        LOGI("Audio stream started successfully");
-        return true;
+        if (result != oboe::Result::OK) {
+            LOGE("Failed to pause audio stream: %s", oboe::convertToText(result));
+            expected = kEnginePaused;
+            state.compare_exchange_strong(expected, kEngineDisconnected, std::memory_order_acq_rel);
+            return;
+        }
+        LOGI("Audio stream paused");
     }
 
+    int getState() const { return state.load(std::memory_order_acquire); }
+
     void stopStream() {
-        if (isStreamRunning && inputStream) {
-            oboe::Result result = inputStream->requestStop();
+        {
+            std::lock_guard<std::mutex> lock(startMutex);
+            cancelStart = true;
+        }
+        startCancelled.notify_all();
+        if (startThread.joinable()) startThread.join();
+
+        int current = state.load(std::memory_order_acquire);
+        if ((current == kEngineRunning || current == kEnginePaused) && inputStream) {
+            oboe::Result result = current == kEngineRunning ? inputStream->requestStop() : oboe::Result::OK;
             if (result != oboe::Result::OK) {
                 LOGE("Failed to stop audio stream: %s", oboe::convertToText(result));
             }
@@ -145,135 +158,192 @@ public:
             if (result != oboe::Result::OK) {
                 LOGE("Failed to close audio stream: %s", oboe::convertToText(result));
             }
-            isStreamRunning = false;
             LOGI("Audio stream stopped and closed");
         } else {
             LOGI("No audio stream to stop or already stopped");
         }
+        state.store(kEngineIdle, std::memory_order_release);
         // Reset buffers to ensure no stale data
         resetBuffers();
     }
 
     oboe::DataCallbackResult onAudioReady(oboe::AudioStream* stream, void* audioData, int32_t numFrames) override {
-        float* input = static_cast<float*>(audioData);
-        int32_t totalSamples = numFrames * stream->getChannelCount();
+        const int32_t samples = numFrames * stream->getChannelCount();
+        if (stream->getFormat() == oboe::AudioFormat::I16) {
+            pipeline.onAudio(static_cast<const int16_t*>(audioData), samples);
+        } else {
+            pipeline.onAudio(static_cast<const float*>(audioData), samples);
+        }
+        return oboe::DataCallbackResult::Continue;
+    }
 
-        float gain = 5.0f; // Reduced gain from 20.0f to 5.0f to prevent saturation
-        for (int i = 0; i < totalSamples && i < sampleSize; i++) {
-            audioBuffer[i] = input[i] * gain;
+    // Oboe has already closed the stream, typically because the device was disconnected
+    void onErrorAfterClose(oboe::AudioStream* stream, oboe::Result error) override {
+        LOGW("Audio stream closed by error: %s", oboe::convertToText(error));
+        for (int expected : {kEngineRunning, kEnginePaused, kEngineStarting}) {
+            if (state.compare_exchange_strong(expected, kEngineDisconnected, std::memory_order_acq_rel)) break;
         }
+    }
 
-        pthread_mutex_lock(&audioMutex);
-        kiss_fftr(fftCfg, audioBuffer, fftOutput);
-        processFrequencies();
-        for (int i = 0; i < 22; i++) lowFreqBuffer[i] = lowFreqMagnitude[i];
-        for (int i = 0; i < 1024; i++) highFreqBuffer[i] = highFreqMagnitude[i];
-        dataReady = true;
-        pthread_cond_signal(&audioCond); // Signal data is ready
-        pthread_mutex_unlock(&audioMutex);
+    bool startAnalysisWorker(int priority, uint64_t cpuMask) {
+        std::lock_guard<std::mutex> lock(workerMutex);
+        return pipeline.startWorker(priority, cpuMask);
+    }
+    void stopAnalysisWorker() {
+        std::lock_guard<std::mutex> lock(workerMutex);
+        pipeline.stopWorker();
+    }
+    void setHopSize(int hopSize) { pipeline.setHopSize(hopSize); }
 
-        return oboe::DataCallbackResult::Continue;
+    bool setAnalyzer(int kind) { return pipeline.setAnalyzer(kind); }
+
+    void setVehicleSpeed(float metersPerSecond) { pipeline.setVehicleSpeed(metersPerSecond); }
+
+    bool setChain(const float* descriptor, int length) {
+        std::lock_guard<std::mutex> lock(workerMutex);
+        return pipeline.setChain(descriptor, length);
+    }
+    void getPipelineStats(int64_t* stats, int count) { pipeline.getStats(stats, count); }
+
+    // AnalysisPipeline::getHistogramStats, then the stream's xrun count (-1 if unsupported)
+    // and the time from startAsync() to the first published spectrum (-1 until then)
+    static constexpr int kEngineStatCount = AnalysisPipeline::kHistogramStatCount + 2;
+    void getEngineStats(int64_t* stats, int count) {
+        pipeline.getHistogramStats(stats, std::min(count, static_cast<int>(AnalysisPipeline::kHistogramStatCount)));
+        bool running = state.load(std::memory_order_acquire) == kEngineRunning;
+        if (count > AnalysisPipeline::kHistogramStatCount) {
+            int64_t xruns = -1;
+            if (running && inputStream && inputStream->isXRunCountSupported()) {
+                auto result = inputStream->getXRunCount();
+                if (result) xruns = result.value();
+            }
+            stats[AnalysisPipeline::kHistogramStatCount] = xruns;
+        }
+        if (count > AnalysisPipeline::kHistogramStatCount + 1) {
+            int64_t firstSpectrumNs = pipeline.getFirstPublishNs();
+            stats[AnalysisPipeline::kHistogramStatCount + 1] = running && firstSpectrumNs > 0 ? firstSpectrumNs - startRequestedNs : -1;
+        }
+    }
+    void* registerSharedSpectrum(size_t* size) { return pipeline.registerSharedSpectrum(size); }
+    int pollBeatEvents(BeatEvent* events, int maxEvents) { return pipeline.pollBeatEvents(events, maxEvents); }
+
+    // Latest band frame; consumes from the triple buffer, so only call from one polling thread
+    void getBandFrame(BandFrame& out) {
+        if (!pipeline.consume()) DSP_TRACE(kTraceNoFreshData);
+        out = pipeline.latest().bands;
+    }
+
+    void resetBuffers() {
+        pipeline.reset(state.load(std::memory_order_acquire) != kEngineRunning);
     }
 
-    void processFrequencies() {
-        const float sampleRate = 48000.0f; // Updated to match new sample rate
-        const float binWidth = sampleRate / sampleSize; // ~23.44 Hz/bin
-        const int lowFreqBins = 6; // ~47-140 Hz (bins 2-6)
-        const int highFreqStart = 7; // ~164 Hz+
-        const float lowSensitivity = 200.0f;
-        const float highSensitivity = 50.0f;
-        float highFreqMax = 0.0f;
-
-        for (int i = 1; i < sampleSize / 2; i++) {
-            float real = fftOutput[i].r;
-            float imag = fftOutput[i].i;
-            float magnitude = sqrtf(real * real + imag * imag) / sampleSize;
-            if (i >= 2 && i < lowFreqBins) { // 47-140 Hz
-                magnitude *= lowSensitivity;
-            } else if (i >= highFreqStart && (i - highFreqStart) < 1024) {
-                magnitude *= highSensitivity;
+private:
+    // Start thread: warm resume of a paused stream, reopening if it no longer starts
+    void restartPaused() {
+        pipeline.reset(true); // Drop the audio from before the pause
+        oboe::Result result = inputStream->requestStart();
+        if (result == oboe::Result::OK) {
+            int expected = kEngineStarting;
+            if (state.compare_exchange_strong(expected, kEngineRunning, std::memory_order_acq_rel)) {
+                LOGI("Audio stream resumed in %.1f ms", (nowNanos() - startRequestedNs) / 1e6);
             } else {
-                magnitude = 0.0f;
-            }
-            // Lower cap to prevent saturation
-            magnitude = std::min(magnitude, 50.0f);
-
-            if (i >= 2 && i - 2 < 22 && i < lowFreqBins) {
-                lowFreqMagnitude[i - 2] = magnitude;
-            } else if (i >= highFreqStart && (i - highFreqStart) < 1024) {
-                highFreqMagnitude[i - highFreqStart] = magnitude;
-                highFreqMax = std::max(highFreqMax, magnitude);
+                LOGW("Audio stream lost while resuming (state %d)", expected);
             }
+            return;
         }
-        LOGI("LowFreq[0]: %f, HighFreq[0]: %f, HighFreq[Max]: %f", lowFreqMagnitude[0], highFreqMagnitude[0], highFreqMax);
+        LOGW("Warm resume failed (%s), reopening the stream", oboe::convertToText(result));
+        inputStream->close();
+        state.store(kEngineStarting, std::memory_order_release);
+        openAndStart();
     }
 
-    void processFrequenciesForJNI(JNIEnv* env, jfloatArray lowFreq, jfloatArray highFreq) {
-        const int lowFreqBins = 22;
-        const int highFreqBins = 1024;
+    // Start thread: open with retries, configure the analysis for the granted
+    // format, start. A stopStream() in the meantime cancels between steps.
+    // The fixed-point analyzer gets I16 capture, the others float.
+    void openAndStart() {
+        const bool i16 = pipeline.getPreferredCaptureFormat() == kCaptureI16;
+        oboe::AudioStreamBuilder builder;
+        builder.setDirection(oboe::Direction::Input)
+                ->setPerformanceMode(oboe::PerformanceMode::LowLatency)
+                // No setSampleRate: take the device's native rate and never resample
+                ->setSampleRateConversionQuality(oboe::SampleRateConversionQuality::None)
+                ->setChannelCount(oboe::ChannelCount::Mono)
+                ->setFormat(i16 ? oboe::AudioFormat::I16 : oboe::AudioFormat::Float)
+                ->setCallback(this);
 
-        jfloat* lowFreqData = env->GetFloatArrayElements(lowFreq, nullptr);
-        jfloat* highFreqData = env->GetFloatArrayElements(highFreq, nullptr);
+        // Retry logic for stream opening
+        const int maxRetries = 3;
+        const int retryDelayMs = 500;
+        for (int attempt = 1; attempt <= maxRetries; attempt++) {
+            oboe::Result result = builder.openManagedStream(inputStream);
+            if (result == oboe::Result::OK) {
+                break;
+            }
+            LOGE("Attempt %d/%d: Failed to open audio stream: %s", attempt, maxRetries, oboe::convertToText(result));
+            if (attempt == maxRetries) {
+                state.store(kEngineFailed, std::memory_order_release);
+                return;
+            }
+            std::unique_lock<std::mutex> lock(startMutex);
+            if (startCancelled.wait_for(lock, std::chrono::milliseconds(retryDelayMs), [this]() { return cancelStart; })) {
+                LOGI("Stream start cancelled while retrying");
+                state.store(kEngineIdle, std::memory_order_release);
+                return;
+            }
+        }
 
-        if (!lowFreqData || !highFreqData) {
-            LOGE("Failed to get float array elements: lowFreqData=%p, highFreqData=%p", lowFreqData, highFreqData);
-            if (lowFreqData) env->ReleaseFloatArrayElements(lowFreq, lowFreqData, JNI_ABORT);
-            if (highFreqData) env->ReleaseFloatArrayElements(highFreq, highFreqData, JNI_ABORT);
+        // Verify stream state before starting
+        if (!inputStream) {
+            LOGE("Audio stream is null after open attempt");
+            state.store(kEngineFailed, std::memory_order_release);
             return;
         }
 
-        pthread_mutex_lock(&audioMutex);
-        const int maxWaitMs = 200; // Increased timeout to 200ms
-        struct timespec ts;
-        clock_gettime(CLOCK_REALTIME, &ts);
-        ts.tv_sec += maxWaitMs / 1000;
-        ts.tv_nsec += (maxWaitMs % 1000) * 1000000;
-        if (ts.tv_nsec >= 1000000000) {
-            ts.tv_sec += 1;
-            ts.tv_nsec -= 1000000000;
+        // Band edges are in Hz, so the bin tables follow whatever rate we were given
+        bool configured;
+        {
+            std::lock_guard<std::mutex> lock(workerMutex);
+            configured = pipeline.configure(static_cast<float>(inputStream->getSampleRate()),
+                                            inputStream->getFramesPerBurst(),
+                                            inputStream->getFormat() == oboe::AudioFormat::I16 ? kCaptureI16
+                                                                                               : kCaptureFloat);
         }
-
-        int waitResult = pthread_cond_timedwait(&audioCond, &audioMutex, &ts);
-        if (waitResult == ETIMEDOUT) {
-            LOGW("Timed out waiting for dataReady, using stale data");
-        } else if (waitResult != 0) {
-            LOGE("pthread_cond_timedwait failed with error: %d", waitResult);
+        if (!configured) {
+            inputStream->close();
+            state.store(kEngineFailed, std::memory_order_release);
+            return;
         }
 
-        if (dataReady) {
-            for (int i = 0; i < lowFreqBins; i++) {
-                lowFreqData[i] = std::max(0.0f, std::min(lowFreqBuffer[i], 1000.0f));
-            }
-            for (int i = 0; i < highFreqBins; i++) {
-                highFreqData[i] = std::max(0.0f, std::min(highFreqBuffer[i], 1000.0f));
+        {
+            std::lock_guard<std::mutex> lock(startMutex);
+            if (cancelStart) {
+                inputStream->close();
+                LOGI("Stream start cancelled before requestStart");
+                state.store(kEngineIdle, std::memory_order_release);
+                return;
             }
-            LOGI("JNI Transfer - LowFreq[0]: %f, HighFreq[0]: %f", lowFreqData[0], highFreqData[0]);
-            dataReady = false; // Reset after transfer
-        } else {
-            LOGW("No fresh data available, buffers remain unchanged");
         }
-        pthread_mutex_unlock(&audioMutex);
 
-        env->ReleaseFloatArrayElements(lowFreq, lowFreqData, 0);
-        env->ReleaseFloatArrayElements(highFreq, highFreqData, 0);
-    }
-
-    void resetBuffers() {
-        pthread_mutex_lock(&audioMutex);
-        for (int i = 0; i < 22; i++) {
-            lowFreqMagnitude[i] = 0.0f;
-            lowFreqBuffer[i] = 0.0f;
+        oboe::Result result = inputStream->requestStart();
+        if (result != oboe::Result::OK) {
+            LOGE("Failed to start audio stream: %s", oboe::convertToText(result));
+            inputStream->close();
+            state.store(kEngineFailed, std::memory_order_release);
+            return;
         }
-        for (int i = 0; i < 1024; i++) {
-            highFreqMagnitude[i] = 0.0f;
-            highFreqBuffer[i] = 0.0f;
+
+        int expected = kEngineStarting;
+        if (!state.compare_exchange_strong(expected, kEngineRunning, std::memory_order_acq_rel)) {
+            LOGW("Audio stream lost while starting (state %d)", expected);
+            return;
         }
-        dataReady = false;
-        pthread_mutex_unlock(&audioMutex);
-        LOGI("Buffers reset");
+        LOGI("Audio stream started in %.1f ms", (nowNanos() - startRequestedNs) / 1e6);
     }
 };
 
+// Every engine Kotlin can reach; JNI calls resolve their handle here
+static EngineRegistry<AudioEngine> gEngines;
+
 extern "C" JNIEXPORT jint JNICALL
 JNI_OnLoad(JavaVM* vm, void* reserved) {
     gJavaVM = vm;
@@ -282,87 +352,329 @@ JNI_OnLoad(JavaVM* vm, void* reserved) {
         LOGE("Failed to get JNIEnv in JNI_OnLoad");
         return -1;
     }
-    LOGI("JNI_OnLoad completed, JavaVM stored");
+    LOGI("JNI_OnLoad completed, JavaVM stored, DSP kernels: %s", selectSpectrumKernels().variant);
     return JNI_VERSION_1_6;
 }
 
 extern "C" JNIEXPORT jlong JNICALL
-Java_com_alexpettit_carbuddy_MainActivity_startAudioEngine(JNIEnv* env, jobject instance, jlong instanceId, jlongArray ptrArray) {
+Java_com_alexpettit_carbuddy_MainActivity_startAudioEngine(JNIEnv* env, jobject instance, jlong instanceId, jlongArray handleArray,
+                                                          jint analyzer) {
     if (!instance) {
         LOGE("Instance is null in startAudioEngine");
         return 0;
     }
     AudioEngine* engine = new AudioEngine(env, instance);
-    if (engine && engine->startStream()) {
-        if (ptrArray && env->GetArrayLength(ptrArray) > 0) {
-            jlong* ptr = env->GetLongArrayElements(ptrArray, nullptr);
-            *ptr = reinterpret_cast<jlong>(engine);
-            env->ReleaseLongArrayElements(ptrArray, ptr, 0);
-        }
-        jclass clazz = env->GetObjectClass(instance);
-        jfieldID fieldId = env->GetFieldID(clazz, "audioEnginePtr", "J");
-        if (fieldId) {
-            env->SetLongField(instance, fieldId, reinterpret_cast<jlong>(engine));
-        } else {
-            LOGE("Failed to set audioEnginePtr field");
-        }
-        LOGI("AudioEngine started, ptr=%p", engine);
-        return reinterpret_cast<jlong>(engine);
-    } else {
-        LOGE("Failed to initialize AudioEngine");
+    jlong handle = gEngines.add(engine);
+    if (handle == 0) {
+        LOGE("Too many audio engines, not starting another");
         delete engine;
         return 0;
     }
+    // Before the open, which picks the capture format for it
+    if (!engine->setAnalyzer(analyzer)) {
+        engine->setAnalyzer(kAnalyzerFft);
+    }
+    // The stream opens in the background; poll getEngineState for the outcome
+    engine->startAsync();
+    if (handleArray && env->GetArrayLength(handleArray) > 0) {
+        env->SetLongArrayRegion(handleArray, 0, 1, &handle);
+    }
+    jclass clazz = env->GetObjectClass(instance);
+    jfieldID fieldId = env->GetFieldID(clazz, "audioEngineHandle", "J");
+    if (fieldId) {
+        env->SetLongField(instance, fieldId, handle);
+    } else {
+        LOGE("Failed to set audioEngineHandle field");
+    }
+    LOGI("AudioEngine starting, handle=%lld", (long long) handle);
+    return handle;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_alexpettit_carbuddy_MainActivity_getEngineState(JNIEnv* env, jobject instance, jlong instanceId, jlong handle) {
+    if (!instance) {
+        LOGE("Instance is null in getEngineState");
+        return kEngineFailed;
+    }
+    EngineRegistry<AudioEngine>::Lease engine = gEngines.acquire(handle);
+    if (!engine) {
+        LOGE("AudioEngine instance not found for getEngineState");
+        return kEngineIdle;
+    }
+    return engine->getState();
 }
 
 extern "C" JNIEXPORT void JNICALL
-Java_com_alexpettit_carbuddy_MainActivity_stopAudioEngine(JNIEnv* env, jobject instance, jlong instanceId, jlong ptr) {
+Java_com_alexpettit_carbuddy_MainActivity_stopAudioEngine(JNIEnv* env, jobject instance, jlong instanceId, jlong handle) {
     if (!instance) {
         LOGE("Instance is null in stopAudioEngine");
         return;
     }
-    AudioEngine* engine = reinterpret_cast<AudioEngine*>(ptr);
+    // Waits for calls already inside the engine; later calls with this handle find nothing
+    AudioEngine* engine = gEngines.remove(handle);
     if (engine) {
-        LOGI("Stopping AudioEngine at %p", engine);
+        LOGI("Stopping AudioEngine, handle=%lld", (long long) handle);
         engine->stopStream();
         delete engine;
         jclass clazz = env->GetObjectClass(instance);
-        jfieldID fieldId = env->GetFieldID(clazz, "audioEnginePtr", "J");
+        jfieldID fieldId = env->GetFieldID(clazz, "audioEngineHandle", "J");
         if (fieldId) {
             env->SetLongField(instance, fieldId, 0L);
-            LOGI("audioEnginePtr reset to 0");
+            LOGI("audioEngineHandle reset to 0");
         } else {
-            LOGE("Failed to reset audioEnginePtr field");
+            LOGE("Failed to reset audioEngineHandle field");
         }
     } else {
-        LOGE("AudioEngine pointer is null in stopAudioEngine");
+        LOGE("AudioEngine handle not found in stopAudioEngine");
+    }
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_alexpettit_carbuddy_MainActivity_setAnalysisWorker(JNIEnv* env, jobject instance, jlong instanceId, jlong handle, jboolean enabled, jint priority, jlong cpuMask) {
+    if (!instance) {
+        LOGE("Instance is null in setAnalysisWorker");
+        return JNI_FALSE;
+    }
+    EngineRegistry<AudioEngine>::Lease engine = gEngines.acquire(handle);
+    if (!engine) {
+        LOGE("AudioEngine instance not found for setAnalysisWorker");
+        return JNI_FALSE;
+    }
+    if (enabled) {
+        return engine->startAnalysisWorker(priority, static_cast<uint64_t>(cpuMask)) ? JNI_TRUE : JNI_FALSE;
+    }
+    engine->stopAnalysisWorker();
+    return JNI_TRUE;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_alexpettit_carbuddy_MainActivity_getPipelineStats(JNIEnv* env, jobject instance, jlong instanceId, jlong handle, jlongArray stats) {
+    if (!instance) {
+        LOGE("Instance is null in getPipelineStats");
+        return;
+    }
+    EngineRegistry<AudioEngine>::Lease engine = gEngines.acquire(handle);
+    if (!engine || !stats) {
+        LOGE("AudioEngine instance not found for getPipelineStats");
+        return;
     }
+    int64_t values[AnalysisPipeline::kStatCount];
+    jlong jvalues[AnalysisPipeline::kStatCount];
+    jsize count = std::min(env->GetArrayLength(stats), static_cast<jsize>(AnalysisPipeline::kStatCount));
+    engine->getPipelineStats(values, count);
+    for (int i = 0; i < count; i++) jvalues[i] = values[i];
+    env->SetLongArrayRegion(stats, 0, count, jvalues);
 }
 
 extern "C" JNIEXPORT void JNICALL
-Java_com_alexpettit_carbuddy_MainActivity_updateFrequencies(JNIEnv* env, jobject instance, jlong instanceId, jlong ptr, jfloatArray lowFreq, jfloatArray highFreq) {
+Java_com_alexpettit_carbuddy_MainActivity_getEngineStats(JNIEnv* env, jobject instance, jlong instanceId, jlong handle, jlongArray stats) {
     if (!instance) {
-        LOGE("Instance is null in updateFrequencies");
+        LOGE("Instance is null in getEngineStats");
         return;
     }
-    AudioEngine* engine = reinterpret_cast<AudioEngine*>(ptr);
+    EngineRegistry<AudioEngine>::Lease engine = gEngines.acquire(handle);
+    if (!engine || !stats) {
+        LOGE("AudioEngine instance not found for getEngineStats");
+        return;
+    }
+    int64_t values[AudioEngine::kEngineStatCount];
+    jlong jvalues[AudioEngine::kEngineStatCount];
+    jsize count = std::min(env->GetArrayLength(stats), static_cast<jsize>(AudioEngine::kEngineStatCount));
+    engine->getEngineStats(values, count);
+    for (int i = 0; i < count; i++) jvalues[i] = values[i];
+    env->SetLongArrayRegion(stats, 0, count, jvalues);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_alexpettit_carbuddy_MainActivity_setHopSize(JNIEnv* env, jobject instance, jlong instanceId, jlong handle, jint hopSize) {
+    if (!instance) {
+        LOGE("Instance is null in setHopSize");
+        return;
+    }
+    EngineRegistry<AudioEngine>::Lease engine = gEngines.acquire(handle);
     if (engine) {
-        engine->processFrequenciesForJNI(env, lowFreq, highFreq);
+        engine->setHopSize(hopSize);
     } else {
-        LOGE("AudioEngine instance not found for updateFrequencies");
+        LOGE("AudioEngine instance not found for setHopSize");
     }
 }
 
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_alexpettit_carbuddy_MainActivity_setAnalyzer(JNIEnv* env, jobject instance, jlong instanceId, jlong handle, jint kind) {
+    if (!instance) {
+        LOGE("Instance is null in setAnalyzer");
+        return JNI_FALSE;
+    }
+    EngineRegistry<AudioEngine>::Lease engine = gEngines.acquire(handle);
+    if (!engine) {
+        LOGE("AudioEngine instance not found for setAnalyzer");
+        return JNI_FALSE;
+    }
+    return engine->setAnalyzer(kind) ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_alexpettit_carbuddy_MainActivity_setDspChain(JNIEnv* env, jobject instance, jlong instanceId, jlong handle, jfloatArray descriptor) {
+    if (!instance) {
+        LOGE("Instance is null in setDspChain");
+        return JNI_FALSE;
+    }
+    EngineRegistry<AudioEngine>::Lease engine = gEngines.acquire(handle);
+    if (!engine || !descriptor) {
+        LOGE("AudioEngine instance not found for setDspChain");
+        return JNI_FALSE;
+    }
+    // A handful of records; copied so the parse never holds the Java array
+    float records[16 * kChainRecordFloats];
+    jsize length = env->GetArrayLength(descriptor);
+    if (length > static_cast<jsize>(sizeof(records) / sizeof(records[0]))) {
+        LOGE("Chain descriptor too long: %d floats", static_cast<int>(length));
+        return JNI_FALSE;
+    }
+    env->GetFloatArrayRegion(descriptor, 0, length, records);
+    return engine->setChain(records, static_cast<int>(length)) ? JNI_TRUE : JNI_FALSE;
+}
+
 extern "C" JNIEXPORT void JNICALL
-Java_com_alexpettit_carbuddy_MainActivity_resetBuffers(JNIEnv* env, jobject instance, jlong ptr) {
+Java_com_alexpettit_carbuddy_MainActivity_setVehicleSpeed(JNIEnv* env, jobject instance, jlong instanceId, jlong handle,
+                                                          jfloat metersPerSecond) {
+    if (!instance) {
+        LOGE("Instance is null in setVehicleSpeed");
+        return;
+    }
+    EngineRegistry<AudioEngine>::Lease engine = gEngines.acquire(handle);
+    if (engine) {
+        engine->setVehicleSpeed(metersPerSecond);
+    } else {
+        LOGE("AudioEngine instance not found for setVehicleSpeed");
+    }
+}
+
+// Fills timestamps[i] and values[3 * i .. 3 * i + 2] = {type, bpm, strength}
+// per event (see BeatTracker.h); returns the number of events copied
+extern "C" JNIEXPORT jint JNICALL
+Java_com_alexpettit_carbuddy_MainActivity_pollBeatEvents(JNIEnv* env, jobject instance, jlong instanceId, jlong handle,
+                                                         jlongArray timestamps, jfloatArray values) {
+    if (!instance) {
+        LOGE("Instance is null in pollBeatEvents");
+        return 0;
+    }
+    EngineRegistry<AudioEngine>::Lease engine = gEngines.acquire(handle);
+    if (!engine || !timestamps || !values) {
+        LOGE("AudioEngine instance not found for pollBeatEvents");
+        return 0;
+    }
+    constexpr int kMaxEvents = 16;
+    int maxEvents = std::min({static_cast<int>(env->GetArrayLength(timestamps)),
+                              static_cast<int>(env->GetArrayLength(values)) / 3, kMaxEvents});
+    BeatEvent events[kMaxEvents];
+    int count = engine->pollBeatEvents(events, maxEvents);
+    jlong eventTimes[kMaxEvents];
+    jfloat eventValues[3 * kMaxEvents];
+    for (int i = 0; i < count; i++) {
+        eventTimes[i] = events[i].timestampNs;
+        eventValues[3 * i] = static_cast<jfloat>(events[i].type);
+        eventValues[3 * i + 1] = events[i].bpm;
+        eventValues[3 * i + 2] = events[i].strength;
+    }
+    if (count > 0) {
+        env->SetLongArrayRegion(timestamps, 0, count, eventTimes);
+        env->SetFloatArrayRegion(values, 0, 3 * count, eventValues);
+    }
+    return count;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_alexpettit_carbuddy_MainActivity_getBandFrame(JNIEnv* env, jobject instance, jlong instanceId, jlong handle, jfloatArray frame) {
+    if (!instance) {
+        LOGE("Instance is null in getBandFrame");
+        return;
+    }
+    EngineRegistry<AudioEngine>::Lease engine = gEngines.acquire(handle);
+    if (!engine || !frame) {
+        LOGE("AudioEngine instance not found for getBandFrame");
+        return;
+    }
+    BandFrame bands;
+    engine->getBandFrame(bands);
+    const jsize floatCount = sizeof(BandFrame) / sizeof(float);
+    env->SetFloatArrayRegion(frame, 0, std::min(env->GetArrayLength(frame), floatCount), reinterpret_cast<const jfloat*>(&bands));
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_alexpettit_carbuddy_MainActivity_registerSpectrumBuffer(JNIEnv* env, jobject instance, jlong instanceId, jlong handle) {
+    if (!instance) {
+        LOGE("Instance is null in registerSpectrumBuffer");
+        return nullptr;
+    }
+    EngineRegistry<AudioEngine>::Lease engine = gEngines.acquire(handle);
+    if (!engine) {
+        LOGE("AudioEngine instance not found for registerSpectrumBuffer");
+        return nullptr;
+    }
+    size_t size = 0;
+    void* data = engine->registerSharedSpectrum(&size);
+    return env->NewDirectByteBuffer(data, static_cast<jlong>(size));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_alexpettit_carbuddy_MainActivity_resetBuffers(JNIEnv* env, jobject instance, jlong handle) {
     if (!instance) {
         LOGE("Instance is null in resetBuffers");
         return;
     }
-    AudioEngine* engine = reinterpret_cast<AudioEngine*>(ptr);
+    EngineRegistry<AudioEngine>::Lease engine = gEngines.acquire(handle);
     if (engine) {
         engine->resetBuffers();
     } else {
         LOGE("AudioEngine instance not found for resetBuffers");
     }
-}
\ No newline at end of file
+}
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_alexpettit_carbuddy_MainActivity_dumpTrace(JNIEnv* env, jobject instance, jlong instanceId, jlong handle, jint maxEntries) {
+    if (!instance) {
+        LOGE("Instance is null in dumpTrace");
+        return nullptr;
+    }
+    // The trace ring is process-wide, so this also works before an engine exists
+    std::string text = dspTrace().formatRecent(static_cast<size_t>(std::max(0, static_cast<int>(maxEntries))));
+    return env->NewStringUTF(text.c_str());
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_alexpettit_carbuddy_MainActivity_getDspVariant(JNIEnv* env, jobject instance, jlong instanceId, jlong handle) {
+    if (!instance) {
+        LOGE("Instance is null in getDspVariant");
+        return nullptr;
+    }
+    // Chosen once per process in JNI_OnLoad, so this also works before an engine exists
+    return env->NewStringUTF(spectrumKernels().variant);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_alexpettit_carbuddy_MainActivity_pauseAudioEngine(JNIEnv* env, jobject instance, jlong instanceId, jlong handle) {
+    if (!instance) {
+        LOGE("Instance is null in pauseAudioEngine");
+        return;
+    }
+    EngineRegistry<AudioEngine>::Lease engine = gEngines.acquire(handle);
+    if (engine) {
+        engine->pause();
+    } else {
+        LOGE("AudioEngine instance not found for pauseAudioEngine");
+    }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_alexpettit_carbuddy_MainActivity_resumeAudioEngine(JNIEnv* env, jobject instance, jlong instanceId, jlong handle) {
+    if (!instance) {
+        LOGE("Instance is null in resumeAudioEngine");
+        return;
+    }
+    EngineRegistry<AudioEngine>::Lease engine = gEngines.acquire(handle);
+    if (engine) {
+        engine->startAsync();
+    } else {
+        LOGE("AudioEngine instance not found for resumeAudioEngine");
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// Automatic gain control for the analysis input. Follows the RMS of the raw
+// input with a fast attack (music got louder) and a slow release (it got
+// quieter), and scales it towards a target RMS, so the bands keep their
+// dynamic range whether the stereo is quiet or loud. The level comes from the
+// pass that already copies the input (see StftAccumulator), so the AGC costs
+// one multiply-add per sample and a few flops per hop.
+class AutoGain {
+public:
+    static constexpr float kMinGain = 0.05f;      // -26 dB for a loud stereo next to the mic
+    static constexpr float kMaxGain = 100.0f;     // 40 dB for a quiet stereo far from the mic
+    static constexpr float kSilenceRms = 1e-4f;   // -80 dBFS; below this the gain holds instead of rising
+
+    void configure(float targetDbfs, float attackSeconds, float releaseSeconds) {
+        targetRms = powf(10.0f, targetDbfs / 20.0f);
+        attack = std::max(attackSeconds, 1e-3f);
+        release = std::max(releaseSeconds, 1e-3f);
+    }
+
+    // Starts from initialGain, with the level it implies at the target
+    void reset(float initialGain) {
+        gain = std::min(std::max(initialGain, kMinGain), kMaxGain);
+        level = targetRms / gain;
+    }
+
+    // meanSquare of the raw input over the last `seconds`; returns the gain for what follows
+    float update(float meanSquare, float seconds) {
+        float rms = sqrtf(meanSquare);
+        float timeConstant = rms > level ? attack : release;
+        level += (1.0f - expf(-seconds / timeConstant)) * (rms - level);
+        if (level > kSilenceRms) {
+            gain = std::min(std::max(targetRms / level, kMinGain), kMaxGain);
+        }
+        return gain;
+    }
+
+    float getGain() const { return gain; }
+
+private:
+    float targetRms = 0.1f;
+    float attack = 0.5f;
+    float release = 4.0f;
+    float level = 0.02f; // Smoothed input RMS
+    float gain = 5.0f;
+};
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "AutoGain.h"
+#include "BandReducer.h"
+#include "FixedPoint.h"
+
+// Optional stages of the analysis chain (gain/AGC -> window -> FFT -> bands ->
+// smoothing); the FFT itself always runs. See DspChain.h for the JNI descriptor.
+enum DspStage : uint32_t {
+    kStageGain = 1u << 0,      // Input gain; off means unity
+    kStageWindow = 1u << 1,    // Window applied to each STFT frame before the FFT
+    kStageBands = 1u << 2,     // Finger band reduction; off leaves the fingers at zero
+    kStageSmoothing = 1u << 3, // Smoothed low average / high peak; off passes the raw values through
+    kStageAgc = 1u << 4,       // AutoGain takes over the input gain, starting from it
+    kStageNoise = 1u << 5,     // NoiseFloor subtraction from the magnitudes, stronger for road noise at speed
+    kStageAll = kStageGain | kStageWindow | kStageBands | kStageSmoothing | kStageAgc | kStageNoise
+};
+
+enum WindowType : int {
+    kWindowRect = 0,           // No window, as the STFT has always run
+    kWindowHann = 1,
+    kWindowBlackmanHarris = 2, // 4-term, -92 dB sidelobes: bass stops leaking into the finger bins
+    kWindowFlatTop = 3,        // Accurate peak amplitudes, widest main lobe
+    kWindowTypeCount
+};
+
+struct SpectrumAnalyzerConfig {
+    int fftSize = 2048;
+    int hopSize = 512;
+    float sampleRate = 48000.0f;
+    float gain = 5.0f;              // Input gain, or the AGC's starting gain; 20x saturated the magnitudes
+    float lowSensitivity = 200.0f;  // Applied to the low band
+    float highSensitivity = 50.0f;  // Applied to the high band
+    float magnitudeCap = 50.0f;     // Lower cap to prevent saturation
+
+    // Band edges in Hz; mapped to bins for whatever rate the stream runs at
+    float lowBandMinHz = 47.0f;
+    float lowBandMaxHz = 140.0f;    // Exclusive
+    float highBandMinHz = 164.0f;
+    float fingerTopHz = 6680.0f;    // Centre of the highest finger band
+    float roadNoiseMaxHz = 500.0f;  // Tyre and wind rumble sits below this
+
+    // Chain settings the analysing thread can retune without reallocating
+    uint32_t stages = kStageAll;    // DspStage bits
+    int window = kWindowRect;
+    float smoothing = 0.7f;         // Weight kept per 50 ms, as the Kotlin smoothing was
+    float agcTargetDbfs = -20.0f;   // RMS the AGC scales the input to; 5x on a typical cabin recording
+    float agcAttackSeconds = 0.5f;
+    float agcReleaseSeconds = 4.0f;
+    float noiseOversubtraction = 1.0f;      // Multiple of the noise floor subtracted when parked
+    float noiseSpeedOversubtraction = 0.5f; // Added below roadNoiseMaxHz at highway speed
+    float noiseSpectralFloor = 0.1f;        // Fraction of a magnitude that always survives subtraction
+};
+
+// One analysed spectrum, handed from the analysing thread to the reader
+struct SpectrumFrame {
+    static constexpr int kLowFreqBins = 22;
+    static constexpr int kHighFreqBins = 1024;
+
+    float lowFreqMagnitude[kLowFreqBins];
+    float highFreqMagnitude[kHighFreqBins];
+    float highFreqMax; // Largest highFreqMagnitude entry this hop, taken while they were written
+    BandFrame bands;
+    float onsetStrength; // Positive spectral flux of this hop, for the BeatTracker
+    int64_t publishedNs; // nowNanos() when the analysing thread published it
+};
+
+// Which BandAnalyzer fills the frames; selectable at runtime through setAnalyzer
+enum AnalyzerKind : int {
+    kAnalyzerFft = 0,      // SpectrumAnalyzer: STFT magnitudes over the full spectrum
+    kAnalyzerEnvelope = 1, // EnvelopeAnalyzer: time-domain filter-bank envelopes, no FFT
+    kAnalyzerFixedFft = 2, // SpectrumAnalyzer on 16-bit PCM: fixed-point FFT, approximated magnitudes
+    kAnalyzerKindCount
+};
+
+// Receives every frame an analyzer produces
+class FrameSink {
+public:
+    // Frame to fill for the hop that just completed
+    virtual SpectrumFrame& beginFrame() = 0;
+    // The frame from beginFrame() is complete
+    virtual void publishFrame() = 0;
+
+protected:
+    ~FrameSink() = default;
+};
+
+// Turns captured PCM into SpectrumFrames. Implementations differ in cost and
+// detail but fill the same frame, so the reader cannot tell them apart. Not
+// thread-safe; owned by whichever thread is currently analysing.
+class BandAnalyzer {
+public:
+    virtual ~BandAnalyzer() = default;
+
+    virtual AnalyzerKind getKind() const = 0;
+
+    // Only call while nothing is analysing. False if the analyzer could not
+    // get its buffers; it then publishes nothing until a configure() succeeds.
+    virtual bool configure(const SpectrumAnalyzerConfig& newConfig) = 0;
+    virtual void reset() = 0;
+
+    virtual int getHopSize() const = 0;
+    virtual void setHopSize(int hopSize) = 0;
+
+    // Takes the chain settings (stages, gain, window, sensitivities, cap,
+    // smoothing) from chain; sizes and rates are left alone. Never allocates,
+    // so the analysing thread can call it between hops.
+    virtual void retune(const SpectrumAnalyzerConfig& chain) = 0;
+
+    // Feeds samples; fills and publishes one frame through sink for every
+    // completed hop. Returns the number of frames published.
+    virtual int analyze(const float* input, int32_t count, FrameSink& sink) = 0;
+
+    // The same for 16-bit PCM (I16 capture). Converts to float a block at a
+    // time unless the analyzer works on int16 itself.
+    virtual int analyze(const int16_t* input, int32_t count, FrameSink& sink) {
+        constexpr int32_t kBlock = 256;
+        float block[kBlock];
+        int frames = 0;
+        while (count > 0) {
+            int32_t chunk = std::min(count, kBlock);
+            pcm16ToFloat(block, input, chunk);
+            frames += analyze(block, chunk, sink);
+            input += chunk;
+            count -= chunk;
+        }
+        return frames;
+    }
+
+    // Gain currently applied to the input: the fixed gain, or the AGC's
+    float getInputGain() const { return inputGain; }
+
+    // From GPS, in m/s; negative when unknown. Scales the road-noise subtraction.
+    void setVehicleSpeed(float metersPerSecond) { vehicleSpeed = metersPerSecond; }
+
+protected:
+    static void copyChainSettings(SpectrumAnalyzerConfig& target, const SpectrumAnalyzerConfig& chain) {
+        target.stages = chain.stages;
+        target.gain = chain.gain;
+        target.window = chain.window;
+        target.lowSensitivity = chain.lowSensitivity;
+        target.highSensitivity = chain.highSensitivity;
+        target.magnitudeCap = chain.magnitudeCap;
+        target.smoothing = chain.smoothing;
+        target.agcTargetDbfs = chain.agcTargetDbfs;
+        target.agcAttackSeconds = chain.agcAttackSeconds;
+        target.agcReleaseSeconds = chain.agcReleaseSeconds;
+        target.noiseOversubtraction = chain.noiseOversubtraction;
+        target.noiseSpeedOversubtraction = chain.noiseSpeedOversubtraction;
+        target.noiseSpectralFloor = chain.noiseSpectralFloor;
+    }
+
+    static float effectiveGain(const SpectrumAnalyzerConfig& config) {
+        return (config.stages & kStageGain) ? config.gain : 1.0f;
+    }
+
+    // Takes the gain settings from config; restart (and a fixed gain) starts
+    // over from config.gain, otherwise a running AGC keeps its level
+    void configureGain(const SpectrumAnalyzerConfig& config, bool restart) {
+        autoGain.configure(config.agcTargetDbfs, config.agcAttackSeconds, config.agcReleaseSeconds);
+        if (restart || !(config.stages & kStageAgc)) {
+            autoGain.reset(effectiveGain(config));
+            inputGain = effectiveGain(config);
+        }
+    }
+
+    // Once per hop, with the mean square of that hop's raw input
+    void updateGain(const SpectrumAnalyzerConfig& config, float meanSquare, float seconds) {
+        if (config.stages & kStageAgc) inputGain = autoGain.update(meanSquare, seconds);
+    }
+
+    // Noise floor multiple to subtract below roadNoiseMaxHz: the parked value
+    // plus the speed term, which reaches its full size at highway speed
+    float roadOversubtraction(const SpectrumAnalyzerConfig& config) const {
+        constexpr float kHighwaySpeed = 30.0f; // m/s, about 110 km/h
+        float speedScale = vehicleSpeed > 0.0f ? std::min(vehicleSpeed / kHighwaySpeed, 1.5f) : 0.0f;
+        return config.noiseOversubtraction + speedScale * config.noiseSpeedOversubtraction;
+    }
+
+    // Low average, high peak and their smoothed values, from the frame's magnitudes;
+    // highFreqMax must already be set
+    void summarizeBands(SpectrumFrame& frame, const SpectrumAnalyzerConfig& config, float hopSeconds) {
+        BandFrame& bands = frame.bands;
+        float lowSum = 0.0f;
+        for (int i = 0; i < SpectrumFrame::kLowFreqBins; i++) lowSum += frame.lowFreqMagnitude[i];
+        bands.lowFreqAvg = lowSum / SpectrumFrame::kLowFreqBins;
+        bands.highFreqPeak = frame.highFreqMax;
+
+        // Weight per 50 ms poll rescaled to the hop period; 0 disables smoothing
+        float smoothing = (config.stages & kStageSmoothing) ? powf(config.smoothing, hopSeconds / 0.05f) : 0.0f;
+        smoothedLowFreqAvg = smoothing * smoothedLowFreqAvg + (1.0f - smoothing) * bands.lowFreqAvg;
+        smoothedHighFreqPeak = smoothing * smoothedHighFreqPeak + (1.0f - smoothing) * bands.highFreqPeak;
+        bands.smoothedLowFreqAvg = smoothedLowFreqAvg;
+        bands.smoothedHighFreqPeak = smoothedHighFreqPeak;
+        bands.beatPhase = -1.0f; // Filled in by whoever runs a BeatTracker
+    }
+
+    void resetSmoothing() {
+        smoothedLowFreqAvg = 0.0f;
+        smoothedHighFreqPeak = 0.0f;
+    }
+
+    float inputGain = 1.0f; // Read by the analyzers at every hop; see configureGain()
+    float vehicleSpeed = -1.0f;
+
+private:
+    AutoGain autoGain;
+    float smoothedLowFreqAvg = 0.0f;
+    float smoothedHighFreqPeak = 0.0f;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "SpectrumKernels.h"
+
+// Everything the stick figure draws from one spectrum. Fixed layout: it is
+// copied verbatim into the shared ByteBuffer and into getBandFrame's FloatArray.
+struct BandFrame {
+    static constexpr int kFingerCount = 10;
+
+    float fingers[kFingerCount];  // Log-spaced bands, mirrored left/right like the drawing
+    float legEnergy;              // Lowest bass bin (~47 Hz)
+    float lowFreqAvg;             // Mean of the low-frequency bins
+    float highFreqPeak;           // Max of the high-frequency bins
+    float smoothedLowFreqAvg;
+    float smoothedHighFreqPeak;
+    float beatPhase;              // 0 on the beat rising to 1 (BeatTracker), -1 without a tempo lock
+};
+static_assert(sizeof(BandFrame) == 16 * sizeof(float), "BandFrame is read by index from Kotlin");
+
+// Reduces the high-frequency magnitudes to a handful of log-spaced bands through
+// a precomputed sparse matrix: each band is a triangular, unit-sum weighting of
+// the bins between its neighbours' centres, stored as contiguous runs.
+class BandReducer {
+public:
+    // Same centres MainActivity.DancingStickFigure used to sample single bins at
+    static std::vector<int> logSpacedCenters(int minBin, int maxBin, int count) {
+        std::vector<int> centers(count);
+        double logBase = std::pow(static_cast<double>(maxBin), 1.0 / (count - 1));
+        double span = std::pow(logBase, count - 1) - 1.0;
+        for (int i = 0; i < count; i++) {
+            int bin = i == 0 ? minBin
+                             : minBin + static_cast<int>((maxBin - minBin) * (std::pow(logBase, i) - 1.0) / span);
+            centers[i] = std::max(minBin, std::min(bin, maxBin));
+        }
+        return centers;
+    }
+
+    explicit BandReducer(const std::vector<int>& centers) {
+        int bands = static_cast<int>(centers.size());
+        for (int band = 0; band < bands; band++) {
+            int center = centers[band];
+            int lower = band > 0 ? centers[band - 1] : center;
+            int upper = band + 1 < bands ? centers[band + 1] : center;
+
+            Run run;
+            run.start = lower + (lower < center ? 1 : 0);
+            run.offset = static_cast<int>(weights.size());
+            float sum = 0.0f;
+            for (int bin = run.start; bin <= upper - (upper > center ? 1 : 0); bin++) {
+                float w;
+                if (bin < center) {
+                    w = static_cast<float>(bin - lower) / static_cast<float>(center - lower);
+                } else if (bin > center) {
+                    w = static_cast<float>(upper - bin) / static_cast<float>(upper - center);
+                } else {
+                    w = 1.0f;
+                }
+                weights.push_back(w);
+                sum += w;
+            }
+            run.count = static_cast<int>(weights.size()) - run.offset;
+            for (int i = 0; i < run.count; i++) weights[run.offset + i] /= sum;
+            runs.push_back(run);
+        }
+    }
+
+    int bandCount() const { return static_cast<int>(runs.size()); }
+
+    void reduce(const float* bins, float* bands) const {
+        for (size_t band = 0; band < runs.size(); band++) {
+            const Run& run = runs[band];
+            bands[band] = dotProduct(weights.data() + run.offset, bins + run.start, run.count);
+        }
+    }
+
+private:
+    struct Run {
+        int start;
+        int count;
+        int offset;
+    };
+
+    std::vector<Run> runs;
+    std::vector<float> weights;
+};
@@ -0,0 +1,209 @@
+#include "BeatTracker.h"
+#include "TraceRing.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr float kThresholdSeconds = 2.0f;   // Time constant of the flux mean and deviation
+constexpr float kOnsetDeviations = 1.5f;    // Onset threshold above the mean, in mean deviations
+constexpr float kMinOnsetGapSeconds = 0.1f;
+constexpr float kWarmUpSeconds = 1.0f;      // No onsets until the threshold has settled
+constexpr float kMinConfidence = 0.2f;      // Below this the flux has no usable periodicity
+constexpr float kPriorBpm = 120.0f;         // Centre of the tempo prior, resolves octave errors
+constexpr float kPriorOctaves = 1.0f;       // Its width
+constexpr float kSameTempo = 0.08f;         // Relative period change still treated as the same tempo
+constexpr float kPeriodSmoothing = 0.3f;
+constexpr float kPhaseCorrection = 0.25f;   // Fraction of an onset's phase error corrected per onset
+constexpr float kPhaseWindow = 0.25f;       // Onsets further than this from a beat are off-beat
+
+} // namespace
+
+BeatTracker::BeatTracker() : hopSeconds(0.0f) {
+    reset();
+}
+
+void BeatTracker::reset() {
+    hopsSeen = 0;
+    historyIndex = 0;
+    std::fill(history, history + 2 * kHistoryHops, 0.0f);
+    fluxMean = 0.0f;
+    fluxDeviation = 0.0f;
+    previousDetection[0] = 0.0f;
+    previousDetection[1] = 0.0f;
+    hopsSinceOnset = kHistoryHops;
+    periodHops = 0.0f;
+    candidatePeriodHops = 0.0f;
+    confidence = 0.0f;
+    beatPhase = 0.0f;
+    gridMisses = 0;
+    locked = false;
+}
+
+int BeatTracker::process(float onsetStrength, float hopSeconds, int64_t timestampNs, BeatEvent* events, float* phase) {
+    if (hopSeconds != this->hopSeconds) {
+        // Lags and time constants are in hops
+        this->hopSeconds = hopSeconds;
+        reset();
+    }
+    const int64_t hopNs = static_cast<int64_t>(hopSeconds * 1e9f);
+    int count = 0;
+
+    // Adaptive threshold: the flux is compared against its own recent level,
+    // so loud and quiet passages (and road noise) need no fixed threshold
+    float alpha = std::min(1.0f, hopSeconds / kThresholdSeconds);
+    if (hopsSeen == 0) fluxMean = onsetStrength;
+    fluxMean += alpha * (onsetStrength - fluxMean);
+    fluxDeviation += alpha * (fabsf(onsetStrength - fluxMean) - fluxDeviation);
+    float detection = std::max(0.0f, onsetStrength - fluxMean);
+    history[historyIndex] = detection;
+    history[historyIndex + kHistoryHops] = detection;
+    historyIndex = (historyIndex + 1) % kHistoryHops;
+    hopsSeen++;
+    hopsSinceOnset++;
+
+    // Peak picking: the previous hop is an onset if it is a local maximum above the threshold
+    float peak = previousDetection[0];
+    float threshold = kOnsetDeviations * fluxDeviation;
+    bool onset = hopsSeen * hopSeconds > kWarmUpSeconds && peak > threshold && peak > previousDetection[1] &&
+                 peak >= detection && (hopsSinceOnset - 1) * hopSeconds >= kMinOnsetGapSeconds;
+    previousDetection[1] = previousDetection[0];
+    previousDetection[0] = detection;
+    if (onset) {
+        hopsSinceOnset = 1;
+        events[count++] = {timestampNs - hopNs, kBeatEventOnset, getBpm(), peak / std::max(fluxDeviation, 1e-12f)};
+    }
+
+    if (hopsSeen % kTempoIntervalHops == 0 && hopsSeen >= kHistoryHops / 2) {
+        estimateTempo();
+    }
+
+    if (!locked) {
+        *phase = -1.0f;
+        return count;
+    }
+    beatPhase += 1.0f / periodHops;
+    if (onset) {
+        // Pull the beat towards onsets that land near it; off-beat onsets are ignored
+        float error = beatPhase - 1.0f / periodHops;
+        error -= floorf(error + 0.5f);
+        if (fabsf(error) < kPhaseWindow) beatPhase -= kPhaseCorrection * error;
+    }
+    if (beatPhase >= 1.0f) {
+        beatPhase -= floorf(beatPhase);
+        int64_t sinceBeatNs = static_cast<int64_t>(beatPhase * periodHops * hopSeconds * 1e9f);
+        events[count++] = {timestampNs - sinceBeatNs, kBeatEventBeat, getBpm(), confidence};
+    }
+    *phase = beatPhase;
+    return count;
+}
+
+void BeatTracker::estimateTempo() {
+    const float* flux = history + historyIndex; // Oldest first
+    const int minLag = std::max(2, static_cast<int>(floorf(60.0f / (kMaxBpm * hopSeconds))));
+    const int maxLag = std::min(kHistoryHops / 2, static_cast<int>(ceilf(60.0f / (kMinBpm * hopSeconds))));
+    if (minLag >= maxLag) {
+        locked = false;
+        return;
+    }
+
+    // Unbiased autocorrelation over the lags in the tempo range, plus one either
+    // side for the interpolation
+    float energy = 0.0f;
+    for (int i = 0; i < kHistoryHops; i++) energy += flux[i] * flux[i];
+    energy /= kHistoryHops;
+    if (energy <= 1e-20f) {
+        locked = false;
+        confidence = 0.0f;
+        return;
+    }
+    float acf[kHistoryHops / 2 + 2];
+    for (int lag = minLag - 1; lag <= maxLag + 1; lag++) {
+        float sum = 0.0f;
+        for (int i = lag; i < kHistoryHops; i++) sum += flux[i] * flux[i - lag];
+        acf[lag - minLag + 1] = sum / (kHistoryHops - lag);
+    }
+    // Each lag is scored with its neighbours: a period between two whole hops
+    // splits its peak across them, which would hand the lead to twice the period
+    int bestLag = 0;
+    float bestScore = 0.0f;
+    for (int lag = minLag; lag <= maxLag; lag++) {
+        const float* around = acf + (lag - minLag);
+        float octaves = log2f(60.0f / (lag * hopSeconds) / kPriorBpm) / kPriorOctaves;
+        float score = (around[0] + around[1] + around[2]) * expf(-0.5f * octaves * octaves);
+        if (score > bestScore) {
+            bestScore = score;
+            bestLag = lag;
+        }
+    }
+    if (bestLag == 0) {
+        locked = false;
+        confidence = 0.0f;
+        return;
+    }
+
+    float before = acf[bestLag - minLag];
+    float at = acf[bestLag - minLag + 1];
+    float after = acf[bestLag - minLag + 2];
+    float curvature = before - 2.0f * at + after;
+    float period = bestLag + (curvature < 0.0f ? 0.5f * (before - after) / curvature : 0.0f);
+    confidence = at / energy;
+    if (confidence < kMinConfidence) {
+        locked = false;
+        return;
+    }
+
+    if (!locked) {
+        periodHops = period;
+        beatPhase = gridPhase() - 1.0f / periodHops; // process() advances it for this hop next
+        candidatePeriodHops = 0.0f;
+        gridMisses = 0;
+        locked = true;
+        DSP_TRACE(kTraceTempoLocked, getBpm(), confidence); // Runs in the audio callback when inline
+        return;
+    }
+
+    // The onset corrections only pull the phase towards nearby onsets, so a lock
+    // onto the off-beat would stay there; move to the grid once it disagrees twice
+    float grid = gridPhase() - 1.0f / periodHops;
+    float gridError = grid - beatPhase;
+    gridError -= floorf(gridError + 0.5f);
+    gridMisses = fabsf(gridError) >= kPhaseWindow ? gridMisses + 1 : 0;
+    if (gridMisses >= 2) {
+        beatPhase = grid;
+        gridMisses = 0;
+    }
+
+    if (fabsf(period - periodHops) < kSameTempo * periodHops) {
+        periodHops += kPeriodSmoothing * (period - periodHops);
+        candidatePeriodHops = 0.0f;
+    } else if (candidatePeriodHops > 0.0f && fabsf(period - candidatePeriodHops) < kSameTempo * candidatePeriodHops) {
+        periodHops = period;
+        candidatePeriodHops = 0.0f;
+        DSP_TRACE(kTraceTempoChanged, getBpm(), confidence);
+    } else {
+        candidatePeriodHops = period;
+    }
+}
+
+float BeatTracker::gridPhase() const {
+    const float* flux = history + historyIndex; // Oldest first, newest at kHistoryHops - 1
+    const int period = std::max(1, static_cast<int>(lroundf(periodHops)));
+    int bestOffset = 0;
+    float bestScore = -1.0f;
+    for (int offset = 0; offset < period; offset++) {
+        // Flux under every beat of the grid whose latest beat was offset hops ago,
+        // with the neighbouring hops at half weight for timing jitter
+        float score = 0.0f;
+        for (int beat = 0;; beat++) {
+            int i = kHistoryHops - 1 - offset - static_cast<int>(lroundf(beat * periodHops));
+            if (i < 1) break;
+            score += flux[i] + 0.5f * (flux[i - 1] + (i + 1 < kHistoryHops ? flux[i + 1] : 0.0f));
+        }
+        if (score > bestScore) {
+            bestScore = score;
+            bestOffset = offset;
+        }
+    }
+    return bestOffset / periodHops;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+enum BeatEventType : uint32_t {
+    kBeatEventOnset = 1, // A note or drum hit; strength is the onset's height above the threshold
+    kBeatEventBeat = 2,  // The tracked pulse; strength is the tempo confidence
+};
+
+struct BeatEvent {
+    int64_t timestampNs; // Same clock as SpectrumFrame::publishedNs
+    uint32_t type;       // BeatEventType
+    float bpm;           // Tempo estimate at the time, 0 before the first lock
+    float strength;
+};
+
+// Onsets, tempo and beat phase from the per-hop onset strength the analyzers
+// put in SpectrumFrame (spectral flux for the FFT path). Onsets are peaks of
+// the flux above an adaptive threshold; the tempo is the strongest
+// autocorrelation lag of the last few seconds of flux, the beat grid at that
+// tempo is placed where it collects the most flux, and a phase-locked counter
+// pulled towards the onsets turns it into beats. Platform-free and
+// allocation-free; owned by the analysing thread.
+class BeatTracker {
+public:
+    static constexpr int kHistoryHops = 384;   // Flux kept for the tempo estimate, ~4 s at 94 hops/s
+    static constexpr int kTempoIntervalHops = 32; // Autocorrelation is rerun this often
+    static constexpr float kMinBpm = 60.0f;
+    static constexpr float kMaxBpm = 180.0f;
+    static constexpr int kMaxEventsPerHop = 2; // One onset and one beat
+
+    BeatTracker();
+
+    void reset();
+
+    // One call per hop, in order. Writes up to kMaxEventsPerHop events and
+    // returns how many; *phase gets the position within the current beat, 0 on
+    // the beat rising towards 1, or -1 while there is no tempo lock.
+    int process(float onsetStrength, float hopSeconds, int64_t timestampNs, BeatEvent* events, float* phase);
+
+    float getBpm() const { return locked ? 60.0f / (periodHops * hopSeconds) : 0.0f; }
+    float getConfidence() const { return confidence; }
+
+private:
+    void estimateTempo();
+    // Phase of the beat grid at periodHops that lines up with the most flux
+    float gridPhase() const;
+
+    float hopSeconds;
+    int hopsSeen;
+    int historyIndex;
+    // Each value is stored twice, kHistoryHops apart, so the autocorrelation
+    // reads the last kHistoryHops values contiguously from historyIndex
+    float history[2 * kHistoryHops];
+    float fluxMean;   // Running mean and mean deviation of the flux, ~2 s
+    float fluxDeviation;
+    float previousDetection[2]; // Flux above the mean one and two hops ago
+    int hopsSinceOnset;
+    float periodHops;           // Beat period; valid once locked
+    float candidatePeriodHops;  // A different tempo has to win twice before it replaces the current one
+    float confidence;           // Autocorrelation at the beat period over that at lag 0
+    float beatPhase;
+    int gridMisses;             // Consecutive estimates whose grid disagreed with beatPhase
+    bool locked;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+// One 64-byte-aligned block that an engine carves all of its DSP buffers from.
+// Every carve starts on its own cache line, so buffers never share a line and
+// SIMD kernels can use aligned loads. reset() only reallocates when the new
+// layout is larger, so reconfiguring to the same FFT size allocates nothing.
+class DspArena {
+public:
+    static constexpr size_t kAlignment = 64;
+
+    DspArena() : base(nullptr), capacity(0), used(0) {}
+    explicit DspArena(size_t bytes) : DspArena() { reset(bytes); }
+    ~DspArena() { std::free(base); }
+
+    DspArena(const DspArena&) = delete;
+    DspArena& operator=(const DspArena&) = delete;
+
+    static constexpr size_t alignUp(size_t bytes) { return (bytes + kAlignment - 1) & ~(kAlignment - 1); }
+
+    // Starts a new layout with room for at least bytes; everything carved before is invalidated
+    bool reset(size_t bytes) {
+        used = 0;
+        bytes = alignUp(bytes);
+        if (bytes <= capacity) return true;
+        std::free(base);
+        base = nullptr;
+        capacity = 0;
+        void* block = nullptr;
+        if (posix_memalign(&block, kAlignment, bytes) != 0) return false;
+        base = static_cast<unsigned char*>(block);
+        capacity = bytes;
+        return true;
+    }
+
+    // Next cache-line-aligned block, or nullptr if the layout did not reserve enough
+    void* carve(size_t bytes) {
+        bytes = alignUp(bytes);
+        if (!base || bytes > capacity - used) return nullptr;
+        void* block = base + used;
+        used += bytes;
+        return block;
+    }
+
+    template <typename T>
+    T* carve(size_t count) { return static_cast<T*>(carve(count * sizeof(T))); }
+
+    size_t getCapacity() const { return capacity; }
+    size_t getUsed() const { return used; }
+
+private:
+    unsigned char* base;
+    size_t capacity;
+    size_t used;
+};
@@ -0,0 +1,89 @@
+#define LOG_TAG "DspChain"
+
+#include "DspChain.h"
+#include "DspLog.h"
+#include "SpectrumAnalyzer.h"
+#include <cmath>
+
+namespace {
+
+// Stage, window and FFT size codes travel as floats; anything but a whole
+// number in int range is malformed rather than truncated (casting NaN or an
+// out-of-range float to int is undefined)
+bool integralCode(float value, int* code) {
+    if (!std::isfinite(value) || value != std::trunc(value) || std::fabs(value) > 1e9f) return false;
+    *code = static_cast<int>(value);
+    return true;
+}
+
+} // namespace
+
+bool parseChainDescriptor(const float* descriptor, int length, SpectrumAnalyzerConfig& config, int* fftSize) {
+    if (!descriptor || length <= 0 || length % kChainRecordFloats != 0) {
+        LOGE("Chain descriptor length %d is not a multiple of %d", length, kChainRecordFloats);
+        return false;
+    }
+    SpectrumAnalyzerConfig result = config;
+    result.stages = 0;
+    int size = 0;
+    for (int offset = 0; offset < length; offset += kChainRecordFloats) {
+        const float* record = descriptor + offset;
+        int stage = 0;
+        int code = 0;
+        bool valid = integralCode(record[0], &stage) && std::isfinite(record[1]) && std::isfinite(record[2]) &&
+                     std::isfinite(record[3]);
+        switch (valid ? stage : 0) { // 0 is no stage: malformed records end up in default
+            case kChainGain:
+                valid = record[1] > 0.0f;
+                result.gain = record[1];
+                result.stages |= kStageGain;
+                break;
+            case kChainWindow:
+                valid = integralCode(record[1], &code) && code >= 0 && code < kWindowTypeCount;
+                result.window = code;
+                result.stages |= kStageWindow;
+                break;
+            case kChainFft:
+                valid = integralCode(record[1], &code) && (code == 0 || SpectrumAnalyzer::isValidFftSize(code));
+                size = code;
+                break;
+            case kChainBands:
+                valid = record[1] > 0.0f && record[2] > 0.0f && record[3] > 0.0f;
+                result.lowSensitivity = record[1];
+                result.highSensitivity = record[2];
+                result.magnitudeCap = record[3];
+                result.stages |= kStageBands;
+                break;
+            case kChainSmoothing:
+                valid = record[1] >= 0.0f && record[1] < 1.0f;
+                result.smoothing = record[1];
+                result.stages |= kStageSmoothing;
+                break;
+            case kChainAgc:
+                valid = record[1] < 0.0f && record[2] > 0.0f && record[3] > 0.0f;
+                result.agcTargetDbfs = record[1];
+                result.agcAttackSeconds = record[2] / 1000.0f;
+                result.agcReleaseSeconds = record[3] / 1000.0f;
+                result.stages |= kStageAgc;
+                break;
+            case kChainNoise:
+                valid = record[1] >= 0.0f && record[2] >= 0.0f && record[3] >= 0.0f && record[3] <= 1.0f;
+                result.noiseOversubtraction = record[1];
+                result.noiseSpeedOversubtraction = record[2];
+                result.noiseSpectralFloor = record[3];
+                result.stages |= kStageNoise;
+                break;
+            default:
+                valid = false;
+                break;
+        }
+        if (!valid) {
+            LOGE("Invalid chain record %d: stage %g (%f, %f, %f)", offset / kChainRecordFloats, record[0],
+                 record[1], record[2], record[3]);
+            return false;
+        }
+    }
+    config = result;
+    *fftSize = size;
+    return true;
+}
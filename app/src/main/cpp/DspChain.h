@@ -0,0 +1,37 @@
+#pragma once
+
+#include "BandAnalyzer.h"
+
+// Compact description of the analysis chain, sent from Kotlin as a FloatArray
+// of fixed-size records {stage, p0, p1, p2}, in chain order:
+//
+//   kChainGain       p0 = gain
+//   kChainWindow     p0 = WindowType: 0 rect, 1 Hann, 2 Blackman-Harris, 3 flat-top
+//   kChainFft        p0 = FFT size (power of two), 0 = chosen from the sample rate
+//   kChainBands      p0 = low sensitivity, p1 = high sensitivity, p2 = magnitude cap
+//   kChainSmoothing  p0 = weight kept per 50 ms, in [0, 1)
+//   kChainAgc        p0 = target RMS in dBFS (< 0), p1 = attack ms, p2 = release ms;
+//                    the gain record's value becomes the AGC's starting gain
+//   kChainNoise      p0 = noise floor multiple subtracted, p1 = extra below
+//                    roadNoiseMaxHz at highway speed, p2 = spectral floor in [0, 1]
+//
+// Optional stages left out of the descriptor are switched off; the FFT always
+// runs, and leaving its record out means an automatic size.
+enum ChainRecord : int {
+    kChainGain = 1,
+    kChainWindow = 2,
+    kChainFft = 3,
+    kChainBands = 4,
+    kChainSmoothing = 5,
+    kChainAgc = 6,
+    kChainNoise = 7,
+};
+
+static constexpr int kChainRecordFloats = 4;
+
+// Applies descriptor on top of config (band edges, rate and hop are kept).
+// *fftSize gets the requested FFT size, 0 for automatic. Leaves both untouched
+// and returns false if any record is malformed: an unknown stage, a
+// parameter out of its range, a code (stage, window, FFT size) that is not a
+// whole number, or any value that is not finite.
+bool parseChainDescriptor(const float* descriptor, int length, SpectrumAnalyzerConfig& config, int* fftSize);
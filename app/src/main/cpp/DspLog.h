@@ -0,0 +1,49 @@
+#pragma once
+
+// Logging for code shared between the Android library and the host build.
+// Each file defines LOG_TAG before including this header.
+#ifndef LOG_TAG
+#define LOG_TAG "CarBuddyDsp"
+#endif
+
+// Compile-time log level; anything above it compiles to nothing. Release builds
+// keep warnings and errors only. Per-hop diagnostics go through DSP_TRACE
+// (TraceRing.h) instead, which is safe on the audio thread at any level.
+#define DSP_LOG_LEVEL_NONE 0
+#define DSP_LOG_LEVEL_ERROR 1
+#define DSP_LOG_LEVEL_WARN 2
+#define DSP_LOG_LEVEL_INFO 3
+
+#ifndef DSP_LOG_LEVEL
+// Host tools run the analysis thousands of times faster than realtime, so info
+// logging is opt-in there
+#if defined(NDEBUG) || (!defined(__ANDROID__) && !defined(DSP_HOST_VERBOSE))
+#define DSP_LOG_LEVEL DSP_LOG_LEVEL_WARN
+#else
+#define DSP_LOG_LEVEL DSP_LOG_LEVEL_INFO
+#endif
+#endif
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define DSP_LOG_WRITE(priority, letter, ...) __android_log_print(priority, LOG_TAG, __VA_ARGS__)
+#else
+#include <cstdio>
+#define DSP_LOG_WRITE(priority, letter, ...) (std::fprintf(stderr, letter "/" LOG_TAG ": " __VA_ARGS__), std::fputc('\n', stderr))
+#endif
+
+#if DSP_LOG_LEVEL >= DSP_LOG_LEVEL_INFO
+#define LOGI(...) DSP_LOG_WRITE(ANDROID_LOG_INFO, "I", __VA_ARGS__)
+#else
+#define LOGI(...) ((void) 0)
+#endif
+#if DSP_LOG_LEVEL >= DSP_LOG_LEVEL_WARN
+#define LOGW(...) DSP_LOG_WRITE(ANDROID_LOG_WARN, "W", __VA_ARGS__)
+#else
+#define LOGW(...) ((void) 0)
+#endif
+#if DSP_LOG_LEVEL >= DSP_LOG_LEVEL_ERROR
+#define LOGE(...) DSP_LOG_WRITE(ANDROID_LOG_ERROR, "E", __VA_ARGS__)
+#else
+#define LOGE(...) ((void) 0)
+#endif
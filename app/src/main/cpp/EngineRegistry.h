@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Fixed table of live engines addressed by opaque handles instead of raw
+// pointers. A handle packs the slot index with the slot's generation, so a
+// handle kept after remove() simply stops resolving instead of pointing at
+// freed memory. Lookups are lock-free (two atomic operations); add() and
+// remove() are serialized by a mutex and only run on the control thread.
+template <typename T, int kSlots = 8>
+class EngineRegistry {
+public:
+    // Keeps the engine alive while held; remove() waits for outstanding leases
+    class Lease {
+    public:
+        Lease() : users(nullptr), object(nullptr) {}
+        Lease(std::atomic<int32_t>* users, T* object) : users(users), object(object) {}
+        Lease(Lease&& other) noexcept : users(other.users), object(other.object) {
+            other.users = nullptr;
+            other.object = nullptr;
+        }
+        ~Lease() {
+            if (users) users->fetch_sub(1, std::memory_order_release);
+        }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+
+        T* get() const { return object; }
+        T* operator->() const { return object; }
+        explicit operator bool() const { return object != nullptr; }
+
+    private:
+        std::atomic<int32_t>* users;
+        T* object;
+    };
+
+    EngineRegistry() = default;
+    EngineRegistry(const EngineRegistry&) = delete;
+    EngineRegistry& operator=(const EngineRegistry&) = delete;
+
+    // Returns the new handle, or 0 if every slot is taken
+    int64_t add(T* object) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = 0; i < kSlots; i++) {
+            Slot& slot = slots[i];
+            uint32_t generation = slot.generation.load(std::memory_order_relaxed);
+            if (generation & 1) continue; // Odd generations are live
+            slot.object = object;
+            slot.generation.store(generation + 1); // Publishes object
+            return makeHandle(i, generation + 1);
+        }
+        return 0;
+    }
+
+    // Any thread, lock-free. Empty if the handle is 0, malformed or removed.
+    Lease acquire(int64_t handle) {
+        int index;
+        uint32_t generation;
+        if (!parseHandle(handle, &index, &generation)) return Lease();
+        Slot& slot = slots[index];
+        // Announce the user before checking the generation; remove() changes
+        // the generation before counting users, so one of the two sees the other
+        slot.users.fetch_add(1);
+        if (slot.generation.load() != generation) {
+            slot.users.fetch_sub(1, std::memory_order_release);
+            return Lease();
+        }
+        return Lease(&slot.users, slot.object);
+    }
+
+    // Invalidates the handle, waits for leases taken before that to be released
+    // and returns the object for the caller to destroy; nullptr if already removed.
+    // Must not be called while the calling thread holds a lease on the same handle.
+    T* remove(int64_t handle) {
+        std::lock_guard<std::mutex> lock(mutex);
+        int index;
+        uint32_t generation;
+        if (!parseHandle(handle, &index, &generation)) return nullptr;
+        Slot& slot = slots[index];
+        if (!slot.generation.compare_exchange_strong(generation, generation + 1)) return nullptr;
+        while (slot.users.load(std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+        T* object = slot.object;
+        slot.object = nullptr;
+        return object;
+    }
+
+private:
+    struct Slot {
+        alignas(64) std::atomic<uint32_t> generation{0};
+        std::atomic<int32_t> users{0};
+        T* object = nullptr;
+    };
+
+    // Low 8 bits: slot index + 1, so 0 is never a valid handle. Upper bits: generation.
+    static int64_t makeHandle(int index, uint32_t generation) {
+        return (static_cast<int64_t>(generation) << 8) | (index + 1);
+    }
+
+    static bool parseHandle(int64_t handle, int* index, uint32_t* generation) {
+        int slot = static_cast<int>(handle & 0xff) - 1;
+        if (handle <= 0 || slot < 0 || slot >= kSlots) return false;
+        *index = slot;
+        *generation = static_cast<uint32_t>(handle >> 8);
+        return (*generation & 1) != 0;
+    }
+
+    std::mutex mutex;
+    Slot slots[kSlots];
+};
@@ -0,0 +1,213 @@
+#define LOG_TAG "EnvelopeAnalyzer"
+
+#include "EnvelopeAnalyzer.h"
+#include "DspLog.h"
+#include "TraceRing.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+float onePoleCoefficient(double cutoffHz, double sampleRate) {
+    return static_cast<float>(1.0 - std::exp(-2.0 * kPi * cutoffHz / sampleRate));
+}
+
+// |H_upper(f) - H_lower(f)| for two one-pole low-passes: the band-pass gain at f
+double bandGain(float lower, float upper, double hz, double sampleRate) {
+    std::complex<double> z = std::polar(1.0, -2.0 * kPi * hz / sampleRate);
+    std::complex<double> hLower = static_cast<double>(lower) / (1.0 - (1.0 - lower) * z);
+    std::complex<double> hUpper = static_cast<double>(upper) / (1.0 - (1.0 - upper) * z);
+    return std::abs(hUpper - hLower);
+}
+
+} // namespace
+
+EnvelopeAnalyzer::EnvelopeAnalyzer(const SpectrumAnalyzerConfig& config)
+        : config(config),
+          configured(false),
+          hopSize(1),
+          samplesUntilHop(1),
+          samplesInHop(0),
+          lowBins(1),
+          energy(0.0f),
+          lowSum(0.0f),
+          lowScale(0.0f),
+          fluxPrimed(false),
+          noiseArena(NoiseFloor::arenaBytes(1 + kFingerBands)),
+          roadBand() {
+    configure(config);
+}
+
+bool EnvelopeAnalyzer::configure(const SpectrumAnalyzerConfig& newConfig) {
+    config = newConfig;
+    hopSize = std::max(1, std::min(config.hopSize, config.fftSize));
+
+    // Same finger centres as SpectrumAnalyzer::buildBinMap, so both analyzers
+    // light up the same highFreqMagnitude entries
+    const float binHz = config.sampleRate / config.fftSize;
+    const int nyquistBin = config.fftSize / 2;
+    auto toBin = [binHz, nyquistBin](float hz) {
+        return std::max(1, std::min(static_cast<int>(lroundf(hz / binHz)), nyquistBin));
+    };
+    int lowBinStart = toBin(config.lowBandMinHz);
+    lowBins = std::max(1, std::min(toBin(config.lowBandMaxHz), lowBinStart + SpectrumFrame::kLowFreqBins) - lowBinStart);
+    int highBinStart = toBin(config.highBandMinHz);
+    int fingerTop = std::min(toBin(config.fingerTopHz) - highBinStart, SpectrumFrame::kHighFreqBins - 1);
+    std::vector<int> centers = BandReducer::logSpacedCenters(0, std::max(fingerTop, 1), kFingerBands);
+    double centerHz[kFingerBands];
+    for (int b = 0; b < kFingerBands; b++) {
+        fingerBins[b] = centers[b];
+        centerHz[b] = (highBinStart + centers[b]) * binHz;
+    }
+
+    // Finger band edges halfway (geometrically) between neighbouring centres
+    const double maxCutoff = 0.45 * config.sampleRate;
+    double cutoffs[kCutoffCount];
+    cutoffs[0] = config.lowBandMinHz;
+    cutoffs[1] = config.lowBandMaxHz;
+    cutoffs[2] = centerHz[0] / std::sqrt(centerHz[1] / centerHz[0]);
+    for (int b = 1; b < kFingerBands; b++) cutoffs[2 + b] = std::sqrt(centerHz[b - 1] * centerHz[b]);
+    cutoffs[2 + kFingerBands] = centerHz[kFingerBands - 1] * std::sqrt(centerHz[kFingerBands - 1] / centerHz[kFingerBands - 2]);
+    for (int f = 0; f < kCutoffCount; f++) {
+        if (f > 2) cutoffs[f] = std::max(cutoffs[f], cutoffs[f - 1] * 1.1); // Coinciding centres at small FFT sizes
+        cutoffs[f] = std::min(cutoffs[f], maxCutoff);
+        coefficients[f] = onePoleCoefficient(cutoffs[f], config.sampleRate);
+    }
+
+    // Mean |x| of a sine is 2A/pi and its FFT magnitude is A/2, hence pi/4 over
+    // the band-pass gain at the band centre. Broadband input spreads over every
+    // bin in the band, so dividing by sqrt(bins) gives the per-bin magnitude the
+    // FFT path reports for music.
+    auto envelopeScale = [&](int lower, double hz) {
+        double gain = bandGain(coefficients[lower], coefficients[lower + 1], hz, config.sampleRate);
+        double bins = std::max(1.0, (cutoffs[lower + 1] - cutoffs[lower]) / binHz);
+        return gain > 1e-3 ? static_cast<float>(kPi / 4.0 / gain / std::sqrt(bins)) : 0.0f;
+    };
+    lowScale = envelopeScale(0, std::sqrt(cutoffs[0] * cutoffs[1]));
+    roadBand[0] = std::sqrt(cutoffs[0] * cutoffs[1]) < config.roadNoiseMaxHz;
+    for (int b = 0; b < kFingerBands; b++) {
+        fingerScales[b] = envelopeScale(2 + b, centerHz[b]);
+        roadBand[1 + b] = centerHz[b] < config.roadNoiseMaxHz;
+    }
+    noiseArena.reset(NoiseFloor::arenaBytes(1 + kFingerBands)); // Same size every time: no allocation
+    configured = noiseFloor.configure(1 + kFingerBands, hopSize / config.sampleRate, noiseArena);
+    LOGI("Envelope bands at %.0f Hz: low %.0f-%.0f Hz, fingers %.0f-%.0f Hz",
+         config.sampleRate, cutoffs[0], cutoffs[1], cutoffs[2], cutoffs[kCutoffCount - 1]);
+    reset();
+    return configured;
+}
+
+// The noise floor is kept, as in SpectrumAnalyzer::reset()
+void EnvelopeAnalyzer::reset() {
+    std::fill(state, state + kCutoffCount, 0.0f);
+    std::fill(fingerSums, fingerSums + kFingerBands, 0.0f);
+    std::fill(previousEnvelopes, previousEnvelopes + 1 + kFingerBands, 0.0f);
+    fluxPrimed = false;
+    energy = 0.0f;
+    lowSum = 0.0f;
+    samplesUntilHop = hopSize;
+    samplesInHop = 0;
+    configureGain(config, true);
+    resetSmoothing();
+}
+
+void EnvelopeAnalyzer::retune(const SpectrumAnalyzerConfig& chain) {
+    bool agcToggled = ((chain.stages ^ config.stages) & kStageAgc) != 0;
+    copyChainSettings(config, chain);
+    configureGain(config, agcToggled);
+}
+
+void EnvelopeAnalyzer::setHopSize(int newHopSize) {
+    hopSize = std::max(1, std::min(newHopSize, config.fftSize));
+    samplesUntilHop = std::min(samplesUntilHop, hopSize);
+    noiseFloor.setHopSeconds(hopSize / config.sampleRate);
+}
+
+int EnvelopeAnalyzer::analyze(const float* input, int32_t count, FrameSink& sink) {
+    if (!configured) return 0;
+    int frames = 0;
+    while (count > 0) {
+        int chunk = std::min<int32_t>(count, samplesUntilHop);
+        const float gain = inputGain; // The AGC may have moved it at the last hop
+        for (int n = 0; n < chunk; n++) {
+            energy += input[n] * input[n];
+            float x = input[n] * gain;
+            for (int f = 0; f < kCutoffCount; f++) {
+                state[f] += coefficients[f] * (x - state[f]);
+            }
+            lowSum += fabsf(state[1] - state[0]);
+            for (int b = 0; b < kFingerBands; b++) {
+                fingerSums[b] += fabsf(state[3 + b] - state[2 + b]);
+            }
+        }
+        input += chunk;
+        count -= chunk;
+        samplesUntilHop -= chunk;
+        samplesInHop += chunk;
+
+        if (samplesUntilHop == 0) {
+            computeFrame(sink.beginFrame());
+            sink.publishFrame();
+            samplesUntilHop = hopSize;
+            frames++;
+        }
+    }
+    return frames;
+}
+
+void EnvelopeAnalyzer::computeFrame(SpectrumFrame& frame) {
+    const float perSample = 1.0f / std::max(samplesInHop, 1);
+    std::fill(frame.lowFreqMagnitude, frame.lowFreqMagnitude + SpectrumFrame::kLowFreqBins, 0.0f);
+    std::fill(frame.highFreqMagnitude, frame.highFreqMagnitude + SpectrumFrame::kHighFreqBins, 0.0f);
+
+    // Onset strength: rises in the band envelopes since the last hop, before
+    // sensitivities and caps, like the FFT path's spectral flux
+    float envelopes[1 + kFingerBands];
+    envelopes[0] = lowSum * perSample * lowScale;
+    for (int b = 0; b < kFingerBands; b++) envelopes[1 + b] = fingerSums[b] * perSample * fingerScales[b];
+    if ((config.stages & kStageNoise) && noiseFloor.getBins() > 0) {
+        const float roadAlpha = roadOversubtraction(config);
+        for (int e = 0; e < 1 + kFingerBands; e++) {
+            float noise = noiseFloor.track(e, envelopes[e]);
+            envelopes[e] = NoiseFloor::subtract(envelopes[e], noise, roadBand[e] ? roadAlpha : config.noiseOversubtraction,
+                                                config.noiseSpectralFloor);
+        }
+        noiseFloor.endHop();
+    }
+    float flux = 0.0f;
+    for (int e = 0; e < 1 + kFingerBands; e++) {
+        flux += std::max(0.0f, envelopes[e] - previousEnvelopes[e]);
+        previousEnvelopes[e] = envelopes[e];
+    }
+    frame.onsetStrength = fluxPrimed ? flux : 0.0f;
+    fluxPrimed = true;
+
+    float low = std::min(envelopes[0] * config.lowSensitivity, config.magnitudeCap);
+    std::fill(frame.lowFreqMagnitude, frame.lowFreqMagnitude + lowBins, low);
+    float pairs[kFingerBands] = {};
+    frame.highFreqMax = 0.0f;
+    for (int b = 0; b < kFingerBands && (config.stages & kStageBands); b++) {
+        pairs[b] = std::min(envelopes[1 + b] * config.highSensitivity, config.magnitudeCap);
+        float& bin = frame.highFreqMagnitude[fingerBins[b]];
+        bin = std::max(bin, pairs[b]);
+        frame.highFreqMax = std::max(frame.highFreqMax, pairs[b]);
+    }
+
+    BandFrame& bands = frame.bands;
+    for (int i = 0; i < BandFrame::kFingerCount; i++) {
+        int pairIndex = i < kFingerBands ? i : BandFrame::kFingerCount - 1 - i;
+        bands.fingers[i] = pairs[pairIndex];
+    }
+    bands.legEnergy = low;
+    summarizeBands(frame, config, hopSize / config.sampleRate);
+    DSP_TRACE(kTraceSpectrum, low, pairs[0], bands.highFreqPeak);
+
+    updateGain(config, energy * perSample, hopSize / config.sampleRate);
+    energy = 0.0f;
+    lowSum = 0.0f;
+    std::fill(fingerSums, fingerSums + kFingerBands, 0.0f);
+    samplesInHop = 0;
+}
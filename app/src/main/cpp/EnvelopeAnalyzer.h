@@ -0,0 +1,55 @@
+#pragma once
+
+#include "BandAnalyzer.h"
+#include "DspArena.h"
+#include "NoiseFloor.h"
+
+// Cheap time-domain analyzer for phones that cannot afford the FFT. A bank of
+// one-pole low-passes is run per sample; the difference of two adjacent
+// low-passes is a band-pass, and its mean absolute value over a hop is the band
+// envelope. Bands match SpectrumAnalyzer's (low band, five log-spaced finger
+// bands) and are scaled to its per-bin magnitudes, so the reader sees the same
+// SpectrumFrame with a coarser spectrum.
+class EnvelopeAnalyzer final : public BandAnalyzer {
+public:
+    explicit EnvelopeAnalyzer(const SpectrumAnalyzerConfig& config);
+
+    EnvelopeAnalyzer(const EnvelopeAnalyzer&) = delete;
+    EnvelopeAnalyzer& operator=(const EnvelopeAnalyzer&) = delete;
+
+    AnalyzerKind getKind() const override { return kAnalyzerEnvelope; }
+    bool configure(const SpectrumAnalyzerConfig& newConfig) override;
+    void reset() override;
+    int getHopSize() const override { return hopSize; }
+    void setHopSize(int newHopSize) override;
+    void retune(const SpectrumAnalyzerConfig& chain) override;
+    using BandAnalyzer::analyze;
+    int analyze(const float* input, int32_t count, FrameSink& sink) override;
+
+private:
+    static constexpr int kFingerBands = BandFrame::kFingerCount / 2;
+    // Low band edges, then the kFingerBands + 1 finger band edges
+    static constexpr int kCutoffCount = 2 + kFingerBands + 1;
+
+    void computeFrame(SpectrumFrame& frame);
+
+    SpectrumAnalyzerConfig config;
+    bool configured;                  // False if the noise floor found no room: analyze() publishes nothing
+    int hopSize;
+    int samplesUntilHop;
+    int samplesInHop;
+    int lowBins;                      // lowFreqMagnitude entries the FFT path fills
+    float coefficients[kCutoffCount]; // One-pole low-pass coefficient per cutoff
+    float state[kCutoffCount];
+    float energy;                     // Sum of squares of the raw input over the current hop, for the AGC
+    float lowSum;                     // Sum of |band| over the current hop
+    float fingerSums[kFingerBands];
+    float lowScale;                   // Turns a mean |band| into an FFT-equivalent magnitude
+    float fingerScales[kFingerBands];
+    int fingerBins[kFingerBands];     // highFreqMagnitude index of each finger band's centre
+    float previousEnvelopes[1 + kFingerBands]; // Low band, then fingers, last hop; for the flux
+    bool fluxPrimed;
+    DspArena noiseArena;              // Only the noise floor's few floats; sized once
+    NoiseFloor noiseFloor;            // One bin per envelope, same order as previousEnvelopes
+    bool roadBand[1 + kFingerBands];  // Band centred below roadNoiseMaxHz
+};
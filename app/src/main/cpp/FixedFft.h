@@ -0,0 +1,33 @@
+#pragma once
+
+// kissfft's real FFT a second time, built with FIXED_POINT=16 (FixedFftCore.c,
+// FixedFftReal.c) for cores where the float one is too heavy: int16 samples,
+// Q15 twiddles, int32 products. Every kissfft symbol of this build is renamed
+// (FixedFftNames.h), so it links next to the float build. Plain C so the C
+// sources can implement it.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int16_t r;
+    int16_t i;
+} FixedComplex;
+
+typedef struct FixedFftPlan FixedFftPlan;
+
+// Plans a forward real FFT of nfft points (even) as kiss_fftr_alloc() does:
+// in mem if *lenmem is large enough, always setting *lenmem to the bytes needed
+FixedFftPlan* fixedFftAlloc(int nfft, void* mem, size_t* lenmem);
+
+// nfft / 2 + 1 bins of timedata. kissfft scales every stage down to stay in
+// range, so the result is the float transform divided by nfft.
+void fixedFft(const FixedFftPlan* plan, const int16_t* timedata, FixedComplex* freqdata);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,4 @@
+// kissfft's complex FFT, fixed-point build (see FixedFft.h). A translation unit
+// of its own because kissfft's private header may not be included twice.
+#include "FixedFftNames.h"
+#include "kissfft/kiss_fft.c"
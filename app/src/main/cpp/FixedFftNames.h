@@ -0,0 +1,14 @@
+#pragma once
+
+// Included first by the fixed-point kissfft sources: Q15 samples, and kissfft's
+// public symbols renamed away from the float build's
+#define FIXED_POINT 16
+
+#define kiss_fft_alloc fixed_kiss_fft_alloc
+#define kiss_fft fixed_kiss_fft
+#define kiss_fft_stride fixed_kiss_fft_stride
+#define kiss_fft_cleanup fixed_kiss_fft_cleanup
+#define kiss_fft_next_fast_size fixed_kiss_fft_next_fast_size
+#define kiss_fftr_alloc fixed_kiss_fftr_alloc
+#define kiss_fftr fixed_kiss_fftr
+#define kiss_fftri fixed_kiss_fftri
@@ -0,0 +1,14 @@
+// kissfft's real FFT, fixed-point build, behind the FixedFft.h interface
+#include "FixedFftNames.h"
+#include "kissfft/kiss_fftr.c"
+#include "FixedFft.h"
+
+typedef char FixedComplexMatchesKiss[sizeof(FixedComplex) == sizeof(kiss_fft_cpx) ? 1 : -1];
+
+FixedFftPlan* fixedFftAlloc(int nfft, void* mem, size_t* lenmem) {
+    return (FixedFftPlan*) kiss_fftr_alloc(nfft, 0, mem, lenmem);
+}
+
+void fixedFft(const FixedFftPlan* plan, const int16_t* timedata, FixedComplex* freqdata) {
+    kiss_fftr((kiss_fftr_cfg) plan, timedata, (kiss_fft_cpx*) freqdata);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include "FixedFft.h"
+
+// 16-bit PCM and Q15 helpers of the fixed-point FFT path (kAnalyzerFixedFft).
+// Plain loops over int16 and int32 that the compiler vectorizes where the ABI
+// has NEON and that stay cheap on VFP-only cores, which have no fast sqrt.
+
+constexpr float kPcm16FullScale = 32768.0f;
+
+inline void pcm16ToFloat(float* dst, const int16_t* src, int count) {
+    for (int i = 0; i < count; i++) dst[i] = src[i] * (1.0f / kPcm16FullScale);
+}
+
+// Rounded and saturated, as Oboe converts float capture to I16
+inline void floatToPcm16(int16_t* dst, const float* src, int count) {
+    for (int i = 0; i < count; i++) {
+        float value = src[i] * kPcm16FullScale;
+        value = value < -32768.0f ? -32768.0f : value > 32767.0f ? 32767.0f : value;
+        dst[i] = static_cast<int16_t>(lrintf(value));
+    }
+}
+
+// dst[i] = src[i] x window[i] with a Q15 window, rounded; window may be null.
+// Returns the largest |dst[i]| for normalizeFrame().
+inline int windowFrameQ15(int16_t* dst, const int16_t* src, int count, const int16_t* window) {
+    int lowest = 0;
+    int highest = 0;
+    for (int i = 0; i < count; i++) {
+        int value = window ? (src[i] * window[i] + (1 << 14)) >> 15 : src[i];
+        dst[i] = static_cast<int16_t>(value);
+        lowest = value < lowest ? value : lowest;
+        highest = value > highest ? value : highest;
+    }
+    return -lowest > highest ? -lowest : highest;
+}
+
+// Shifts the frame left until its peak fills int16, so a quiet cabin keeps
+// its bits through kissfft's per-stage scaling; returns the shift (the block
+// exponent the magnitudes are scaled back by)
+inline int normalizeFrame(int16_t* frame, int count, int peak) {
+    if (peak <= 0 || peak >= 16384) return 0;
+    int shift = __builtin_clz(static_cast<unsigned>(peak)) - 17; // peak << shift lands in [16384, 32767]
+    for (int i = 0; i < count; i++) frame[i] = static_cast<int16_t>(frame[i] * (1 << shift));
+    return shift;
+}
+
+// |r + ij| x 32768 to within 1% without a square root: the larger of two
+// alpha-max-plus-beta-min lines, with coefficients in Q15 fitted for the
+// smallest worst-case error. Fits int32 for any int16 pair.
+inline int32_t approxMagnitudeQ15(int32_t r, int32_t i) {
+    int32_t a = r < 0 ? -r : r;
+    int32_t b = i < 0 ? -i : i;
+    int32_t larger = a > b ? a : b;
+    int32_t smaller = a > b ? b : a;
+    int32_t steep = 32450 * larger + 6448 * smaller;
+    int32_t shallow = 27510 * larger + 18382 * smaller;
+    return steep > shallow ? steep : shallow;
+}
+
+// approxMagnitudeQ15() of bins [begin, end), as floats for the magnitude kernel; dst is indexed by bin
+inline void approxMagnitudes(float* dst, const FixedComplex* spectrum, int begin, int end) {
+    for (int i = begin; i < end; i++) dst[i] = static_cast<float>(approxMagnitudeQ15(spectrum[i].r, spectrum[i].i));
+}
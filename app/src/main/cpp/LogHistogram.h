@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Log-bucketed histogram with four buckets per power of two (<19% bucket width),
+// covering the whole int64 range. One writing thread, any number of readers:
+// record() is a couple of relaxed loads and stores, no read-modify-write.
+// Cache-line aligned so histograms written by different threads never share a line.
+class alignas(64) LogHistogram {
+public:
+    static constexpr int kBucketCount = 248;
+
+    struct Summary {
+        int64_t p50;
+        int64_t p99;
+        int64_t max;
+        int64_t count;
+    };
+
+    // Writer thread only
+    void record(int64_t value) {
+        if (value < 0) value = 0;
+        std::atomic<uint32_t>& bucket = buckets[bucketIndex(static_cast<uint64_t>(value))];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (value > max.load(std::memory_order_relaxed)) {
+            max.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    // Any thread. Percentiles are bucket upper bounds, clipped to the observed max.
+    Summary summarize() const {
+        uint32_t snapshot[kBucketCount];
+        uint64_t total = 0;
+        for (int i = 0; i < kBucketCount; i++) {
+            snapshot[i] = buckets[i].load(std::memory_order_relaxed);
+            total += snapshot[i];
+        }
+        int64_t observedMax = max.load(std::memory_order_relaxed);
+        Summary summary = {percentile(snapshot, total, 0.50, observedMax),
+                           percentile(snapshot, total, 0.99, observedMax),
+                           observedMax,
+                           static_cast<int64_t>(total)};
+        return summary;
+    }
+
+    static int bucketIndex(uint64_t value) {
+        if (value < 4) return static_cast<int>(value);
+        int msb = 63 - __builtin_clzll(value);
+        int sub = static_cast<int>((value >> (msb - 2)) & 3);
+        return (msb - 1) * 4 + sub;
+    }
+
+    static int64_t bucketUpperBound(int index) {
+        if (index < 4) return index;
+        int msb = index / 4 + 1;
+        uint64_t width = 1ULL << (msb - 2);
+        uint64_t lower = (4ULL + index % 4) << (msb - 2);
+        uint64_t upper = lower + width - 1;
+        return upper > static_cast<uint64_t>(INT64_MAX) ? INT64_MAX : static_cast<int64_t>(upper);
+    }
+
+private:
+    static int64_t percentile(const uint32_t* snapshot, uint64_t total, double fraction, int64_t observedMax) {
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(fraction * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kBucketCount; i++) {
+            seen += snapshot[i];
+            if (seen >= rank) {
+                int64_t bound = bucketUpperBound(i);
+                return bound < observedMax ? bound : observedMax;
+            }
+        }
+        return observedMax;
+    }
+
+    std::atomic<uint32_t> buckets[kBucketCount] = {};
+    std::atomic<int64_t> max{0};
+};
@@ -0,0 +1,68 @@
+#define LOG_TAG "NoiseFloor"
+
+#include "NoiseFloor.h"
+#include "DspLog.h"
+#include <cfloat>
+#include <cmath>
+
+NoiseFloor::NoiseFloor()
+        : bins(0),
+          hopsPerSubWindow(1),
+          hopsInSubWindow(0),
+          subWindow(0),
+          smoothing(1.0f),
+          smoothedMagnitude(nullptr),
+          currentMinimum(nullptr),
+          windowMinimum(nullptr),
+          subWindowMinimum() {}
+
+bool NoiseFloor::configure(int binCount, float hopSeconds, DspArena& arena) {
+    bins = 0;
+    smoothedMagnitude = arena.carve<float>(binCount);
+    currentMinimum = arena.carve<float>(binCount);
+    windowMinimum = arena.carve<float>(binCount);
+    bool carved = smoothedMagnitude && currentMinimum && windowMinimum;
+    for (int w = 0; w < kSubWindows; w++) {
+        subWindowMinimum[w] = arena.carve<float>(binCount);
+        carved = carved && subWindowMinimum[w];
+    }
+    if (!carved) {
+        LOGE("Arena too small for a %d-bin noise floor", binCount);
+        return false;
+    }
+    bins = binCount;
+    setHopSeconds(hopSeconds);
+    reset();
+    return true;
+}
+
+void NoiseFloor::setHopSeconds(float hopSeconds) {
+    hopsPerSubWindow = std::max(1, static_cast<int>(lroundf(kWindowSeconds / kSubWindows / hopSeconds)));
+    smoothing = 1.0f - expf(-hopSeconds / kSmoothingSeconds);
+}
+
+void NoiseFloor::reset() {
+    if (bins == 0) return;
+    std::fill(smoothedMagnitude, smoothedMagnitude + bins, 0.0f);
+    std::fill(currentMinimum, currentMinimum + bins, FLT_MAX);
+    std::fill(windowMinimum, windowMinimum + bins, FLT_MAX);
+    for (float* minimum : subWindowMinimum) std::fill(minimum, minimum + bins, FLT_MAX);
+    hopsInSubWindow = 0;
+    subWindow = 0;
+}
+
+void NoiseFloor::endHop() {
+    if (++hopsInSubWindow < hopsPerSubWindow) return;
+    // Retire the oldest sub-window: once every kSubWindows sub-windows, so the
+    // bins x kSubWindows pass costs a fraction of a compare per bin per hop
+    float* retired = subWindowMinimum[subWindow];
+    std::copy(currentMinimum, currentMinimum + bins, retired);
+    std::fill(currentMinimum, currentMinimum + bins, FLT_MAX);
+    for (int i = 0; i < bins; i++) {
+        float minimum = subWindowMinimum[0][i];
+        for (int w = 1; w < kSubWindows; w++) minimum = std::min(minimum, subWindowMinimum[w][i]);
+        windowMinimum[i] = minimum;
+    }
+    subWindow = (subWindow + 1) % kSubWindows;
+    hopsInSubWindow = 0;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include "DspArena.h"
+
+// Per-bin noise floor by minimum statistics: each bin's magnitude is smoothed
+// over ~0.1 s and the minimum of that over the last ~1.5 s is taken as the
+// stationary noise under it (road, tyre and wind noise change slowly, music
+// keeps dipping). The minimum is kept as kSubWindows sub-window minima, so a
+// floor that rises (the car sped up) takes over after about a window without
+// storing the whole history; one that falls takes over at once. subtract()
+// then removes the floor from the bin. All state lives in the caller's arena;
+// nothing allocates after configure().
+class NoiseFloor {
+public:
+    static constexpr int kSubWindows = 4;
+    static constexpr float kWindowSeconds = 1.5f;
+    static constexpr float kSmoothingSeconds = 0.1f;
+    static constexpr float kBias = 1.5f; // The minimum of a smoothed magnitude underestimates its mean
+
+    static size_t arenaBytes(int bins) { return (3 + kSubWindows) * DspArena::alignUp(bins * sizeof(float)); }
+
+    NoiseFloor();
+
+    // Carves the per-bin state for bins values from arena and clears it.
+    // Returns false if the arena is too small; track() must not be called then.
+    bool configure(int bins, float hopSeconds, DspArena& arena);
+
+    // Time constants are in hops; keeps the estimate
+    void setHopSeconds(float hopSeconds);
+
+    // Forgets the estimate; it rebuilds over the next window
+    void reset();
+
+    // This hop's magnitude of bin; returns the bin's noise floor magnitude
+    float track(int bin, float magnitude) {
+        float smoothed = smoothedMagnitude[bin] += smoothing * (magnitude - smoothedMagnitude[bin]);
+        float current = currentMinimum[bin] = std::min(currentMinimum[bin], smoothed);
+        return kBias * std::min(windowMinimum[bin], current);
+    }
+
+    // Magnitude with the floor removed: oversubtraction times the floor comes
+    // off, but never more than leaves spectralFloor of the magnitude, so
+    // nothing is zeroed into musical-noise holes
+    static float subtract(float magnitude, float noise, float oversubtraction, float spectralFloor) {
+        return std::max(magnitude - oversubtraction * noise, spectralFloor * magnitude);
+    }
+
+    // After every bin of a hop has been tracked
+    void endHop();
+
+    int getBins() const { return bins; }
+
+    // The per-bin state, for kernels that track many bins at once with the
+    // same update as track() (see SpectrumKernels.h)
+    struct Lanes {
+        float* smoothedMagnitude;
+        float* currentMinimum;
+        const float* windowMinimum;
+        float smoothing;
+    };
+    Lanes getLanes() const { return {smoothedMagnitude, currentMinimum, windowMinimum, smoothing}; }
+
+private:
+    int bins;
+    int hopsPerSubWindow;
+    int hopsInSubWindow;
+    int subWindow;            // Next subWindowMinimum row to overwrite
+    float smoothing;          // One-pole coefficient per hop
+    float* smoothedMagnitude; // bins floats each, in the arena
+    float* currentMinimum;    // Minimum of the sub-window in progress
+    float* windowMinimum;     // Minimum over the completed sub-windows
+    float* subWindowMinimum[kSubWindows];
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "BandReducer.h"
+#include "BeatTracker.h"
+#include "SpectrumKernels.h"
+
+// Native memory exposed to Kotlin as a direct ByteBuffer (native byte order).
+// The analysing thread publishes every spectrum into it under a sequence lock:
+// sequence is odd while a frame is being written and even once it is complete,
+// so the reader copies the floats and accepts them only if sequence was even
+// and unchanged across the copy. Reading needs no JNI call and no lock.
+// The BeatTracker's events go into a ring after the spectrum under the same
+// lock: eventsWritten counts every event ever published, and event n is in
+// slot n % eventCapacity until eventCapacity more have been published.
+//
+// Byte layout:
+//   0  uint32 sequence
+//   4  uint32 lowCount
+//   8  uint32 highCount
+//   12 uint32 framesPublished
+//   16 BandFrame bands (16 floats)
+//   80 float lowFreq[lowCount]
+//   .. float highFreq[highCount]
+//   E  uint32 eventsWritten, at E = 80 + 4 * (lowCount + highCount)
+//   .. uint32 eventCapacity
+//   .. BeatEvent events[eventCapacity] (24 bytes each: int64 timestampNs,
+//      uint32 type, float bpm, float strength, 4 bytes padding)
+// Several seconds of beats and onsets at two events per hop at most
+constexpr int kSharedBeatEventCapacity = 64;
+
+template <int LowCount, int HighCount>
+struct SharedSpectrumLayout {
+    std::atomic<uint32_t> sequence;
+    uint32_t lowCount;
+    uint32_t highCount;
+    uint32_t framesPublished;
+    BandFrame bands;
+    float lowFreq[LowCount];
+    float highFreq[HighCount];
+    uint32_t eventsWritten;
+    uint32_t eventCapacity;
+    BeatEvent events[kSharedBeatEventCapacity];
+};
+
+template <int LowCount, int HighCount>
+class SharedSpectrumBuffer {
+public:
+    using Layout = SharedSpectrumLayout<LowCount, HighCount>;
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "sequence must be a plain 32-bit word");
+    static_assert(offsetof(Layout, bands) == 16, "Kotlin reads the band frame from byte offset 16");
+    static_assert(offsetof(Layout, lowFreq) == 80, "Kotlin reads the spectrum from byte offset 80");
+    static_assert(offsetof(Layout, eventsWritten) == 80 + 4 * (LowCount + HighCount),
+                  "Kotlin finds the events right after the spectrum");
+    static_assert(offsetof(Layout, events) == offsetof(Layout, eventsWritten) + 8 && sizeof(BeatEvent) == 24,
+                  "Kotlin reads BeatEvents as 24-byte records after the event header");
+
+    SharedSpectrumBuffer() : layout(new Layout()), registered(false) {
+        layout->sequence.store(0, std::memory_order_relaxed);
+        layout->lowCount = LowCount;
+        layout->highCount = HighCount;
+        layout->framesPublished = 0;
+        layout->bands = BandFrame();
+        std::fill(layout->lowFreq, layout->lowFreq + LowCount, 0.0f);
+        std::fill(layout->highFreq, layout->highFreq + HighCount, 0.0f);
+        layout->eventsWritten = 0;
+        layout->eventCapacity = kSharedBeatEventCapacity;
+        std::fill(layout->events, layout->events + kSharedBeatEventCapacity, BeatEvent());
+    }
+
+    ~SharedSpectrumBuffer() { delete layout; }
+
+    SharedSpectrumBuffer(const SharedSpectrumBuffer&) = delete;
+    SharedSpectrumBuffer& operator=(const SharedSpectrumBuffer&) = delete;
+
+    void* data() const { return layout; }
+    static constexpr size_t size() { return sizeof(Layout); }
+
+    // Called from the JNI thread once Kotlin holds the ByteBuffer
+    void setRegistered(bool value) { registered.store(value, std::memory_order_release); }
+    bool isRegistered() const { return registered.load(std::memory_order_acquire); }
+
+    // Single writer: the analysing thread. events are this hop's beat events.
+    void publish(const BandFrame& bands, const float* low, const float* high, float minValue, float maxValue,
+                 const BeatEvent* events = nullptr, int eventCount = 0) {
+        uint32_t sequence = layout->sequence.load(std::memory_order_relaxed);
+        layout->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        layout->bands = bands;
+        clampCopy(layout->lowFreq, low, LowCount, minValue, maxValue);
+        clampCopy(layout->highFreq, high, HighCount, minValue, maxValue);
+        for (int i = 0; i < eventCount; i++) {
+            layout->events[layout->eventsWritten++ % kSharedBeatEventCapacity] = events[i];
+        }
+        layout->framesPublished++;
+        layout->sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+private:
+    Layout* layout;
+    std::atomic<bool> registered;
+};
@@ -0,0 +1,223 @@
+#include "SizedFft.h"
+#include <atomic>
+#include <cstdint>
+
+// A real FFT of N points is a complex FFT of N / 2 points over the even and
+// odd samples, then the split kissfft does in kiss_fftr(). The complex FFT is
+// radix 4 (after one radix-2 stage when log2(N / 2) is odd), decimation in
+// time from bit-reversed input, with every stage instantiated for its size.
+
+namespace {
+
+std::atomic<bool> sizedFftEnabled(true);
+
+constexpr double kHalfPi = 1.57079632679489661923;
+
+// Taylor series, accurate to double precision for |x| <= pi / 4
+constexpr double sinSeries(double x) {
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 10; n++) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cosSeries(double x) {
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 10; n++) {
+        term *= -x * x / ((2 * n - 1) * (2 * n));
+        sum += term;
+    }
+    return sum;
+}
+
+// e^(-2 pi i k / n), reduced to an angle of at most pi / 4 exactly in integers
+constexpr kiss_fft_cpx unitRoot(long k, long n) {
+    long quarterTurns = (4 * k) / n;
+    long rest = 4 * k - quarterTurns * n; // The angle past them is (pi / 2) rest / n
+    double c = 0.0;
+    double s = 0.0;
+    if (2 * rest <= n) {
+        double x = kHalfPi * rest / n;
+        c = cosSeries(x);
+        s = sinSeries(x);
+    } else {
+        double x = kHalfPi * (n - rest) / n;
+        c = sinSeries(x);
+        s = cosSeries(x);
+    }
+    double cosine = 0.0;
+    double sine = 0.0;
+    switch (quarterTurns % 4) {
+        case 0: cosine = c; sine = s; break;
+        case 1: cosine = -s; sine = c; break;
+        case 2: cosine = -c; sine = -s; break;
+        default: cosine = s; sine = -c; break;
+    }
+    return {static_cast<float>(cosine), static_cast<float>(-sine)};
+}
+
+constexpr int log2Of(int n) {
+    int bits = 0;
+    while ((1 << bits) < n) bits++;
+    return bits;
+}
+
+// First radix-4 stage with twiddles: sub-FFTs of 2 points after a radix-2
+// stage, of 4 after an untwiddled radix-4 one
+constexpr int firstTwiddledQuarter(int m) { return log2Of(m) % 2 ? 2 : 4; }
+
+constexpr int twiddleCount(int m) {
+    int count = 0;
+    for (int quarter = firstTwiddledQuarter(m); 4 * quarter <= m; quarter *= 4) count += 3 * quarter;
+    return count;
+}
+
+template <int M>
+struct BitReverse {
+    uint16_t index[M];
+    constexpr BitReverse() : index() {
+        const int bits = log2Of(M);
+        for (int k = 0; k < M; k++) {
+            int reversed = 0;
+            for (int b = 0; b < bits; b++) reversed |= ((k >> b) & 1) << (bits - 1 - b);
+            index[k] = static_cast<uint16_t>(reversed);
+        }
+    }
+};
+
+// Per radix-4 stage of quarter Q, w^j, w^2j and w^3j for j < Q (w = e^(-2 pi i / 4Q)),
+// each run contiguous so the butterflies load them in step with the data
+template <int M>
+struct StageTwiddles {
+    kiss_fft_cpx w[twiddleCount(M) > 0 ? twiddleCount(M) : 1];
+    constexpr StageTwiddles() : w() {
+        int offset = 0;
+        for (int quarter = firstTwiddledQuarter(M); 4 * quarter <= M; quarter *= 4) {
+            for (int power = 1; power <= 3; power++) {
+                for (int j = 0; j < quarter; j++) w[offset++] = unitRoot(power * j, 4 * quarter);
+            }
+        }
+    }
+};
+
+// kiss_fftr()'s super twiddles: -i e^(-2 pi i k / N) for k = 1 to N / 4
+template <int N>
+struct SplitTwiddles {
+    kiss_fft_cpx w[N / 4];
+    constexpr SplitTwiddles() : w() {
+        for (int k = 1; k <= N / 4; k++) {
+            kiss_fft_cpx root = unitRoot(k, N);
+            w[k - 1] = {root.i, -root.r};
+        }
+    }
+};
+
+template <int M>
+constexpr BitReverse<M> kBitReverse{};
+template <int M>
+constexpr StageTwiddles<M> kStageTwiddles{};
+template <int N>
+constexpr SplitTwiddles<N> kSplitTwiddles{};
+
+inline kiss_fft_cpx add(kiss_fft_cpx a, kiss_fft_cpx b) { return {a.r + b.r, a.i + b.i}; }
+inline kiss_fft_cpx sub(kiss_fft_cpx a, kiss_fft_cpx b) { return {a.r - b.r, a.i - b.i}; }
+inline kiss_fft_cpx mul(kiss_fft_cpx a, kiss_fft_cpx b) { return {a.r * b.r - a.i * b.i, a.r * b.i + a.i * b.r}; }
+
+// The even and odd samples at bit-reversed index k, as one complex point
+inline kiss_fft_cpx loadPair(const float* timedata, int k) { return {timedata[2 * k], timedata[2 * k + 1]}; }
+
+// Four sub-FFTs of Q points at z, in bit-reversed order (those of the samples
+// 0, 2, 1 and 3 mod 4), into one of 4Q
+inline void butterfly4(kiss_fft_cpx* z, int j, int quarter, kiss_fft_cpx t1, kiss_fft_cpx t2, kiss_fft_cpx t3) {
+    kiss_fft_cpx a0 = z[j];
+    kiss_fft_cpx s0 = add(a0, t2);
+    kiss_fft_cpx d0 = sub(a0, t2);
+    kiss_fft_cpx s1 = add(t1, t3);
+    kiss_fft_cpx d1 = sub(t1, t3);
+    z[j] = add(s0, s1);
+    z[j + 2 * quarter] = sub(s0, s1);
+    z[j + quarter] = {d0.r + d1.i, d0.i - d1.r};     // d0 - i d1
+    z[j + 3 * quarter] = {d0.r - d1.i, d0.i + d1.r}; // d0 + i d1
+}
+
+// Bit-reversed load fused with the first stage, which needs no twiddles
+template <int M>
+void firstStage(const float* timedata, kiss_fft_cpx* z) {
+    const uint16_t* reverse = kBitReverse<M>.index;
+    if constexpr (log2Of(M) % 2) {
+        for (int i = 0; i < M; i += 2) {
+            kiss_fft_cpx a = loadPair(timedata, reverse[i]);
+            kiss_fft_cpx b = loadPair(timedata, reverse[i + 1]);
+            z[i] = add(a, b);
+            z[i + 1] = sub(a, b);
+        }
+    } else {
+        for (int i = 0; i < M; i += 4) {
+            z[i] = loadPair(timedata, reverse[i]);
+            butterfly4(z + i, 0, 1, loadPair(timedata, reverse[i + 2]), loadPair(timedata, reverse[i + 1]),
+                       loadPair(timedata, reverse[i + 3]));
+        }
+    }
+}
+
+template <int M, int Q>
+void radix4Stages(kiss_fft_cpx* z, const kiss_fft_cpx* twiddles) {
+    const kiss_fft_cpx* w1 = twiddles;
+    const kiss_fft_cpx* w2 = twiddles + Q;
+    const kiss_fft_cpx* w3 = twiddles + 2 * Q;
+    for (int base = 0; base < M; base += 4 * Q) {
+        kiss_fft_cpx* group = z + base;
+        for (int j = 0; j < Q; j++) {
+            butterfly4(group, j, Q, mul(group[j + 2 * Q], w1[j]), mul(group[j + Q], w2[j]),
+                       mul(group[j + 3 * Q], w3[j]));
+        }
+    }
+    if constexpr (16 * Q <= M) radix4Stages<M, 4 * Q>(z, twiddles + 3 * Q);
+}
+
+// kiss_fftr()'s split of the half-size complex FFT into the real one, in place
+template <int N>
+void splitSpectrum(kiss_fft_cpx* freqdata) {
+    constexpr int M = N / 2;
+    const kiss_fft_cpx* twiddles = kSplitTwiddles<N>.w;
+    kiss_fft_cpx dc = freqdata[0];
+    freqdata[0] = {dc.r + dc.i, 0.0f};
+    freqdata[M] = {dc.r - dc.i, 0.0f};
+    for (int k = 1; k <= M / 2; k++) {
+        kiss_fft_cpx fpk = freqdata[k];
+        kiss_fft_cpx fpnk = {freqdata[M - k].r, -freqdata[M - k].i};
+        kiss_fft_cpx f1k = add(fpk, fpnk);
+        kiss_fft_cpx tw = mul(sub(fpk, fpnk), twiddles[k - 1]);
+        freqdata[k] = {0.5f * (f1k.r + tw.r), 0.5f * (f1k.i + tw.i)};
+        freqdata[M - k] = {0.5f * (f1k.r - tw.r), 0.5f * (tw.i - f1k.i)};
+    }
+}
+
+template <int N>
+void realFft(const float* timedata, kiss_fft_cpx* freqdata) {
+    constexpr int M = N / 2;
+    firstStage<M>(timedata, freqdata);
+    radix4Stages<M, firstTwiddledQuarter(M)>(freqdata, kStageTwiddles<M>.w);
+    splitSpectrum<N>(freqdata);
+}
+
+} // namespace
+
+SizedFftFunction sizedFft(int fftSize) {
+    if (!sizedFftEnabled.load(std::memory_order_relaxed)) return nullptr;
+    switch (fftSize) {
+        case 512: return realFft<512>;
+        case 1024: return realFft<1024>;
+        case 2048: return realFft<2048>;
+        case 4096: return realFft<4096>;
+        default: return nullptr;
+    }
+}
+
+void setSizedFftEnabled(bool enabled) {
+    sizedFftEnabled.store(enabled, std::memory_order_relaxed);
+}
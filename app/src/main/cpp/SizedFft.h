@@ -0,0 +1,17 @@
+#pragma once
+
+#include "kissfft/kiss_fft.h"
+
+// Real FFTs specialized at compile time for the sizes the analyzer normally
+// runs at (512 to 4096): the stage layout, loop bounds, bit-reversal and
+// twiddle tables are all fixed per size, so there is no plan to allocate and
+// nothing to look up per call. Same output as kiss_fftr(): fftSize / 2 + 1
+// bins, unnormalized. Other sizes keep using kissfft.
+using SizedFftFunction = void (*)(const float* timedata, kiss_fft_cpx* freqdata);
+
+// The specialized FFT for fftSize, or nullptr if there is none or they are disabled
+SizedFftFunction sizedFft(int fftSize);
+
+// Process-wide; analyzers pick it up at their next configure(). On by
+// default, off to compare against kissfft (the benchmarks, WavReplay).
+void setSizedFftEnabled(bool enabled);
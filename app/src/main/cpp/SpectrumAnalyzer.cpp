@@ -0,0 +1,313 @@
+#define LOG_TAG "SpectrumAnalyzer"
+
+#include "SpectrumAnalyzer.h"
+#include "DspLog.h"
+#include "TraceRing.h"
+#include <algorithm>
+#include <cmath>
+
+SpectrumAnalyzer::SpectrumAnalyzer(const SpectrumAnalyzerConfig& config, DspArena* sharedArena, AnalyzerKind kind)
+        : kind(kind == kAnalyzerFixedFft ? kAnalyzerFixedFft : kAnalyzerFft),
+          config(config),
+          arena(sharedArena ? sharedArena : &ownArena),
+          configured(false),
+          fftCfg(nullptr),
+          sizedTransform(nullptr),
+          fftOutput(nullptr),
+          windowTables(),
+          coherentGains(),
+          window(nullptr),
+          magnitudeScale(0.0f),
+          fixedCfg(nullptr),
+          fixedOutput(nullptr),
+          fixedWindowTables(),
+          fixedWindow(nullptr),
+          fixedMagnitude(nullptr),
+          fixedFrameScale(0.0f),
+          previousMagnitude(nullptr),
+          fluxPrimed(false),
+          roadBinEnd(0),
+          lowBinStart(0),
+          lowBinEnd(0),
+          highBinStart(0),
+          fingerBands(std::vector<int>(1, 0)),
+          segments(),
+          segmentCount(0) {
+    configure(config);
+}
+
+int SpectrumAnalyzer::fftSizeForSampleRate(float sampleRate) {
+    float target = sampleRate * (2048.0f / 48000.0f);
+    int size = kMinFftSize;
+    while (size < kMaxFftSize && size * 1.5f < target) size <<= 1;
+    return size;
+}
+
+size_t SpectrumAnalyzer::arenaBytes(int fftSize, AnalyzerKind kind) {
+    size_t common = DspArena::alignUp(fftSize / 2 * sizeof(float)) // Previous magnitudes
+                    + NoiseFloor::arenaBytes(fftSize / 2);
+    if (kind == kAnalyzerFixedFft) {
+        size_t planBytes = 0;
+        fixedFftAlloc(fftSize, nullptr, &planBytes);
+        return common + DspArena::alignUp(planBytes)
+               + DspArena::alignUp((fftSize / 2 + 1) * sizeof(FixedComplex))
+               + 2 * DspArena::alignUp(fftSize * sizeof(int16_t)) // STFT history and frame
+               + (kWindowTypeCount - 1) * DspArena::alignUp(fftSize * sizeof(int16_t)) // Window tables
+               + DspArena::alignUp(fftSize / 2 * sizeof(float)); // Approximated magnitudes
+    }
+    size_t kissBytes = 0;
+    kiss_fftr_alloc(fftSize, 0, nullptr, &kissBytes);
+    return common + DspArena::alignUp(kissBytes)
+           + DspArena::alignUp((fftSize / 2 + 1) * sizeof(kiss_fft_cpx))
+           + 2 * DspArena::alignUp(fftSize * sizeof(float)) // STFT history and frame
+           + (kWindowTypeCount - 1) * DspArena::alignUp(fftSize * sizeof(float)); // Window tables
+}
+
+bool SpectrumAnalyzer::configure(const SpectrumAnalyzerConfig& newConfig) {
+    config = newConfig;
+    configured = false;
+    if (arena == &ownArena) {
+        ownArena.reset(arenaBytes(config.fftSize, kind));
+    }
+    bool carved = isFixedPoint() ? carveFixed() : carveFloat();
+    previousMagnitude = arena->carve<float>(config.fftSize / 2);
+    bool noiseFloorCarved = noiseFloor.configure(config.fftSize / 2, config.hopSize / config.sampleRate, *arena);
+    if (!carved || !previousMagnitude || !noiseFloorCarved) {
+        LOGE("Arena too small for fftSize=%d (%zu of %zu bytes used); analyzer disabled", config.fftSize,
+             arena->getUsed(), arena->getCapacity());
+        return false;
+    }
+    configured = true;
+    buildBinMap();
+    buildWindows();
+    selectWindow();
+    reset();
+    return true;
+}
+
+bool SpectrumAnalyzer::carveFloat() {
+    // The common sizes have a specialized FFT and need no plan. Otherwise
+    // kiss_fftr builds its plan inside the arena (lenmem), so there is nothing to free.
+    sizedTransform = sizedFft(config.fftSize);
+    fftCfg = nullptr;
+    if (!sizedTransform) {
+        size_t kissBytes = 0;
+        kiss_fftr_alloc(config.fftSize, 0, nullptr, &kissBytes);
+        void* kissMem = arena->carve(kissBytes);
+        fftCfg = kissMem ? kiss_fftr_alloc(config.fftSize, 0, kissMem, &kissBytes) : nullptr;
+    }
+    fftOutput = arena->carve<kiss_fft_cpx>(config.fftSize / 2 + 1);
+    float* history = arena->carve<float>(config.fftSize);
+    float* frame = arena->carve<float>(config.fftSize);
+    bool tablesCarved = true;
+    windowTables[kWindowRect] = nullptr;
+    for (int type = kWindowRect + 1; type < kWindowTypeCount; type++) {
+        windowTables[type] = arena->carve<float>(config.fftSize);
+        tablesCarved = tablesCarved && windowTables[type];
+    }
+    if (!(sizedTransform || fftCfg) || !fftOutput || !history || !frame || !tablesCarved) return false;
+    stft.configure(config.fftSize, config.hopSize, history, frame);
+    return true;
+}
+
+bool SpectrumAnalyzer::carveFixed() {
+    size_t planBytes = 0;
+    fixedFftAlloc(config.fftSize, nullptr, &planBytes);
+    void* planMem = arena->carve(planBytes);
+    fixedCfg = planMem ? fixedFftAlloc(config.fftSize, planMem, &planBytes) : nullptr;
+    fixedOutput = arena->carve<FixedComplex>(config.fftSize / 2 + 1);
+    int16_t* history = arena->carve<int16_t>(config.fftSize);
+    int16_t* frame = arena->carve<int16_t>(config.fftSize);
+    bool tablesCarved = true;
+    fixedWindowTables[kWindowRect] = nullptr;
+    for (int type = kWindowRect + 1; type < kWindowTypeCount; type++) {
+        fixedWindowTables[type] = arena->carve<int16_t>(config.fftSize);
+        tablesCarved = tablesCarved && fixedWindowTables[type];
+    }
+    fixedMagnitude = arena->carve<float>(config.fftSize / 2);
+    if (!fixedCfg || !fixedOutput || !history || !frame || !tablesCarved || !fixedMagnitude) return false;
+    fixedStft.configure(config.fftSize, config.hopSize, history, frame);
+    return true;
+}
+
+void SpectrumAnalyzer::retune(const SpectrumAnalyzerConfig& chain) {
+    bool windowChanged = chain.window != config.window || ((chain.stages ^ config.stages) & kStageWindow) != 0;
+    bool agcToggled = ((chain.stages ^ config.stages) & kStageAgc) != 0;
+    copyChainSettings(config, chain);
+    if (windowChanged) selectWindow();
+    configureGain(config, agcToggled);
+}
+
+// Periodic cosine-sum windows, so the frame's ends meet as the FFT assumes.
+// Built once per FFT size; switching windows at runtime only swaps the pointer.
+// The fixed-point analyzer's tables are Q15, and their gains are of the
+// rounded coefficients.
+void SpectrumAnalyzer::buildWindows() {
+    static const double kCoefficients[kWindowTypeCount][5] = {
+        {1.0, 0.0, 0.0, 0.0, 0.0},                                      // Rect, no table
+        {0.5, 0.5, 0.0, 0.0, 0.0},                                      // Hann
+        {0.35875, 0.48829, 0.14128, 0.01168, 0.0},                      // Blackman-Harris, 4-term
+        {0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368} // Flat-top
+    };
+    const int n = config.fftSize;
+    coherentGains[kWindowRect] = 1.0f;
+    for (int type = kWindowRect + 1; type < kWindowTypeCount; type++) {
+        float* table = windowTables[type];
+        int16_t* fixedTable = fixedWindowTables[type];
+        if (!table && !fixedTable) {
+            coherentGains[type] = 1.0f;
+            continue;
+        }
+        const double* a = kCoefficients[type];
+        double sum = 0.0;
+        for (int i = 0; i < n; i++) {
+            double x = 2.0 * M_PI * i / n;
+            double w = a[0] - a[1] * cos(x) + a[2] * cos(2.0 * x) - a[3] * cos(3.0 * x) + a[4] * cos(4.0 * x);
+            if (fixedTable) {
+                fixedTable[i] = static_cast<int16_t>(std::max(0L, std::min(lround(w * 32768.0), 32767L)));
+                sum += fixedTable[i] / 32768.0;
+            } else {
+                table[i] = static_cast<float>(w);
+                sum += w;
+            }
+        }
+        coherentGains[type] = static_cast<float>(sum / n);
+    }
+}
+
+void SpectrumAnalyzer::selectWindow() {
+    int type = (config.stages & kStageWindow) ? config.window : kWindowRect;
+    if (type < 0 || type >= kWindowTypeCount) type = kWindowRect;
+    bool tableBuilt = isFixedPoint() ? fixedWindowTables[type] != nullptr : windowTables[type] != nullptr;
+    if (type != kWindowRect && !tableBuilt) type = kWindowRect;
+    window = windowTables[type];
+    fixedWindow = fixedWindowTables[type];
+    // The fixed-point spectrum is already divided by fftSize, and its
+    // magnitudes are in Q15 of int16 full scale
+    magnitudeScale = isFixedPoint() ? 1.0f / (kPcm16FullScale * kPcm16FullScale * coherentGains[type])
+                                    : 1.0f / (config.fftSize * coherentGains[type]);
+}
+
+void SpectrumAnalyzer::buildBinMap() {
+    const float binHz = config.sampleRate / config.fftSize;
+    const int nyquistBin = config.fftSize / 2;
+    auto toBin = [binHz, nyquistBin](float hz) {
+        return std::max(1, std::min(static_cast<int>(lroundf(hz / binHz)), nyquistBin));
+    };
+    lowBinStart = toBin(config.lowBandMinHz);
+    lowBinEnd = std::min(toBin(config.lowBandMaxHz), lowBinStart + SpectrumFrame::kLowFreqBins);
+    highBinStart = toBin(config.highBandMinHz);
+    roadBinEnd = toBin(config.roadNoiseMaxHz);
+
+    int fingerTop = std::min(toBin(config.fingerTopHz) - highBinStart, SpectrumFrame::kHighFreqBins - 1);
+    fingerBands = BandReducer(BandReducer::logSpacedCenters(0, std::max(fingerTop, 1), BandFrame::kFingerCount / 2));
+
+    // Same precedence as a per-bin test: low band first, then the high band
+    const int highBinEnd = std::min(highBinStart + SpectrumFrame::kHighFreqBins, nyquistBin);
+    int bounds[] = {1, lowBinStart, lowBinEnd, highBinStart, highBinEnd, roadBinEnd, nyquistBin};
+    const int boundCount = sizeof(bounds) / sizeof(bounds[0]);
+    std::sort(bounds, bounds + boundCount);
+    segmentCount = 0;
+    for (int b = 0; b + 1 < boundCount; b++) {
+        int begin = bounds[b];
+        int end = bounds[b + 1];
+        if (begin >= end) continue;
+        SegmentTarget target = begin >= lowBinStart && begin < lowBinEnd ? kSegmentLow
+                               : begin >= highBinStart && begin < highBinEnd ? kSegmentHigh
+                               : kSegmentNone;
+        segments[segmentCount++] = {begin, end, target, begin < roadBinEnd};
+    }
+    LOGI("Bin map at %.0f Hz, fftSize=%d: low bins %d-%d, high from bin %d, finger top bin %d",
+         config.sampleRate, config.fftSize, lowBinStart, lowBinEnd - 1, highBinStart, fingerTop);
+}
+
+void SpectrumAnalyzer::setHopSize(int hopSize) {
+    if (isFixedPoint()) {
+        fixedStft.setHopSize(hopSize);
+    } else {
+        stft.setHopSize(hopSize);
+    }
+    noiseFloor.setHopSeconds(getHopSize() / config.sampleRate);
+}
+
+// The noise floor is kept: the cabin sounds the same after a pause or an analyzer switch
+void SpectrumAnalyzer::reset() {
+    if (!configured) return;
+    if (isFixedPoint()) {
+        fixedStft.reset();
+    } else {
+        stft.reset();
+    }
+    fluxPrimed = false;
+    configureGain(config, true);
+    resetSmoothing();
+}
+
+void SpectrumAnalyzer::transform(const float* window) {
+    if (sizedTransform) {
+        sizedTransform(window, fftOutput);
+    } else {
+        kiss_fftr(fftCfg, window, fftOutput);
+    }
+}
+
+// Called before the AGC moves on, so the gain is the one the float path
+// would have unrolled this frame with
+void SpectrumAnalyzer::transform(const int16_t* frame, int shift) {
+    fixedFft(fixedCfg, frame, fixedOutput);
+    fixedFrameScale = ldexpf(magnitudeScale * inputGain, -shift);
+}
+
+void SpectrumAnalyzer::processFrequencies(SpectrumFrame& frame) {
+    MagnitudeParams params = {magnitudeScale, config.magnitudeCap, previousMagnitude, nullptr, config.noiseSpectralFloor,
+                              nullptr};
+    if (isFixedPoint()) {
+        approxMagnitudes(fixedMagnitude, fixedOutput, 1, config.fftSize / 2);
+        params.scale = fixedFrameScale;
+        params.magnitudes = fixedMagnitude;
+    }
+    NoiseFloor::Lanes noise;
+    const bool denoise = (config.stages & kStageNoise) && noiseFloor.getBins() > 0;
+    if (denoise) {
+        noise = noiseFloor.getLanes();
+        params.noise = &noise;
+    }
+    const float roadAlpha = roadOversubtraction(config);
+    float highFreqMax = 0.0f;
+    float flux = 0.0f; // Onset strength: rises in magnitude since the last hop, over the whole spectrum
+
+    for (int s = 0; s < segmentCount; s++) {
+        const BinSegment& bins = segments[s];
+        MagnitudeSegment segment = {bins.begin, bins.end, nullptr, 0.0f,
+                                    bins.road ? roadAlpha : config.noiseOversubtraction};
+        if (bins.target == kSegmentLow) {
+            segment.out = frame.lowFreqMagnitude + (bins.begin - lowBinStart);
+            segment.sensitivity = config.lowSensitivity;
+        } else if (bins.target == kSegmentHigh) {
+            segment.out = frame.highFreqMagnitude + (bins.begin - highBinStart);
+            segment.sensitivity = config.highSensitivity;
+        }
+        float peak = magnitudeKernel(fftOutput, segment, params, &flux);
+        if (bins.target == kSegmentHigh) highFreqMax = std::max(highFreqMax, peak);
+    }
+    frame.highFreqMax = highFreqMax;
+    frame.onsetStrength = fluxPrimed ? flux : 0.0f; // The first hop after a reset rises from silence
+    fluxPrimed = true;
+    if (denoise) noiseFloor.endHop();
+    DSP_TRACE(kTraceSpectrum, frame.lowFreqMagnitude[0], frame.highFreqMagnitude[0], highFreqMax);
+}
+
+// Everything DancingStickFigure draws, so Kotlin never touches the full spectrum
+void SpectrumAnalyzer::reduceBands(SpectrumFrame& frame) {
+    BandFrame& bands = frame.bands;
+    float pairs[BandFrame::kFingerCount / 2] = {};
+    if (config.stages & kStageBands) {
+        fingerBands.reduce(frame.highFreqMagnitude, pairs);
+    }
+    for (int i = 0; i < BandFrame::kFingerCount; i++) {
+        int pairIndex = i < BandFrame::kFingerCount / 2 ? i : BandFrame::kFingerCount - 1 - i;
+        bands.fingers[i] = pairs[pairIndex];
+    }
+    bands.legEnergy = frame.lowFreqMagnitude[0];
+    summarizeBands(frame, config, getHopSize() / config.sampleRate);
+}
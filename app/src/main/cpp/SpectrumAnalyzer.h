@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cstdint>
+#include "kissfft/kiss_fft.h"
+#include "kissfft/kiss_fftr.h"
+#include "BandAnalyzer.h"
+#include "BandReducer.h"
+#include "DspArena.h"
+#include "FixedFft.h"
+#include "NoiseFloor.h"
+#include "SizedFft.h"
+#include "SpectrumKernels.h"
+#include "StftAccumulator.h"
+
+// FFT and band analysis core, the full-detail BandAnalyzer. Platform-free: no
+// JNI, Oboe or Android logging, so it builds and benchmarks on a desktop host.
+// The float FFT is a specialized one (SizedFft.h) from 512 to 4096 points,
+// kissfft at other sizes. Built as kAnalyzerFixedFft it works on int16 from the STFT to the spectrum:
+// Q15 window, kissfft's fixed-point FFT and approximated magnitudes (see
+// FixedPoint.h), for 32-bit ARM cores where the float FFT is too heavy. Its
+// frames match the float ones to within a few percent.
+class SpectrumAnalyzer final : public BandAnalyzer {
+public:
+    static constexpr int kMinFftSize = 256;
+    static constexpr int kMaxFftSize = 8192;
+
+    // Buffers and the FFT plan come from sharedArena if given (its owner must
+    // reset() it with room for arenaBytes() before construction and before each
+    // configure()), otherwise from an arena the analyzer owns. kind is
+    // kAnalyzerFft or kAnalyzerFixedFft.
+    explicit SpectrumAnalyzer(const SpectrumAnalyzerConfig& config, DspArena* sharedArena = nullptr,
+                              AnalyzerKind kind = kAnalyzerFft);
+
+    // Power-of-two size giving the same ~43 ms window (and Hz resolution) as 2048 at 48 kHz
+    static int fftSizeForSampleRate(float sampleRate);
+
+    // A power of two from kMinFftSize to kMaxFftSize
+    static bool isValidFftSize(int size) { return size >= kMinFftSize && size <= kMaxFftSize && (size & (size - 1)) == 0; }
+
+    // Arena space needed for the FFT plan (if any), spectrum, STFT buffers, flux history and noise floor
+    static size_t arenaBytes(int fftSize, AnalyzerKind kind = kAnalyzerFft);
+
+    // Rebuilds the FFT plan and the Hz-to-bin tables, and clears the history.
+    // Allocates only if the arena has to grow; only call while nothing is analysing.
+    // False if the arena is too small, leaving the analyzer disabled.
+    bool configure(const SpectrumAnalyzerConfig& newConfig) override;
+
+    SpectrumAnalyzer(const SpectrumAnalyzer&) = delete;
+    SpectrumAnalyzer& operator=(const SpectrumAnalyzer&) = delete;
+
+    AnalyzerKind getKind() const override { return kind; }
+    bool isFixedPoint() const { return kind == kAnalyzerFixedFft; }
+    const SpectrumAnalyzerConfig& getConfig() const { return config; }
+    int getFftSize() const { return config.fftSize; }
+    int getHopSize() const override { return isFixedPoint() ? fixedStft.getHopSize() : stft.getHopSize(); }
+    void setHopSize(int hopSize) override;
+    void reset() override;
+    void retune(const SpectrumAnalyzerConfig& chain) override;
+
+    int analyze(const float* input, int32_t count, FrameSink& sink) override {
+        if (!configured) return 0;
+        auto onTransform = [&]() {
+            computeFrame(sink.beginFrame());
+            sink.publishFrame();
+        };
+        return isFixedPoint() ? processConverted(input, count, onTransform) : process(input, count, onTransform);
+    }
+
+    int analyze(const int16_t* input, int32_t count, FrameSink& sink) override {
+        if (!configured) return 0;
+        if (!isFixedPoint()) return BandAnalyzer::analyze(input, count, sink);
+        return process(input, count, [&]() {
+            computeFrame(sink.beginFrame());
+            sink.publishFrame();
+        });
+    }
+
+    // Feeds samples through the STFT. For every completed hop the frame is
+    // scaled by the input gain and windowed in the same pass and transformed,
+    // the AGC sees the hop's level, and onTransform() is called; it normally
+    // calls computeFrame().
+    template <typename OnTransform>
+    int process(const float* input, int32_t count, OnTransform&& onTransform) {
+        return stft.push(input, count, inputGain, window, [&](float* frame) {
+            transform(frame);
+            updateGain(config, stft.getHopMeanSquare(), stft.getHopSize() / config.sampleRate);
+            onTransform();
+        });
+    }
+
+    // The fixed-point analyzer's process(). The gain is applied to the
+    // magnitudes instead of the frame, so a hot input cannot clip the FFT.
+    template <typename OnTransform>
+    int process(const int16_t* input, int32_t count, OnTransform&& onTransform) {
+        return fixedStft.pushNormalized(input, count, fixedWindow, [&](int16_t* frame, int shift) {
+            transform(frame, shift);
+            updateGain(config, fixedStft.getHopMeanSquare(), fixedStft.getHopSize() / config.sampleRate);
+            onTransform();
+        });
+    }
+
+    // Magnitudes and bands from the most recent transform
+    void computeFrame(SpectrumFrame& frame) {
+        processFrequencies(frame);
+        reduceBands(frame);
+    }
+
+    // Individual stages, public so the host benchmarks can time them in isolation
+    void transform(const float* window);
+    void transform(const int16_t* frame, int shift); // Fixed point; shift is the frame's normalization
+    void processFrequencies(SpectrumFrame& frame);
+    void reduceBands(SpectrumFrame& frame);
+    const kiss_fft_cpx* getFftOutput() const { return fftOutput; }
+    bool usesSizedFft() const { return sizedTransform != nullptr; }
+    const FixedComplex* getFixedOutput() const { return fixedOutput; }
+
+private:
+    // Bins 1 to fftSize / 2 - 1, split wherever the band or the road-noise
+    // range changes, so magnitudeKernel() sees uniform runs
+    enum SegmentTarget { kSegmentNone, kSegmentLow, kSegmentHigh };
+    struct BinSegment {
+        int begin;
+        int end;
+        SegmentTarget target;
+        bool road; // Below roadNoiseMaxHz
+    };
+    static constexpr int kMaxSegments = 8;
+
+    // Float input to the fixed-point analyzer, a block at a time
+    template <typename OnTransform>
+    int processConverted(const float* input, int32_t count, OnTransform&& onTransform) {
+        constexpr int32_t kBlock = 256;
+        int16_t block[kBlock];
+        int frames = 0;
+        while (count > 0) {
+            int32_t chunk = std::min(count, kBlock);
+            floatToPcm16(block, input, chunk);
+            frames += process(block, chunk, onTransform);
+            input += chunk;
+            count -= chunk;
+        }
+        return frames;
+    }
+
+    // The float or the fixed-point plan and buffers; false if the arena ran out
+    bool carveFloat();
+    bool carveFixed();
+    void buildBinMap();
+    // Fills every window table for the current FFT size; configure() only
+    void buildWindows();
+    // Points the STFT at the configured window's table; cheap enough for retune()
+    void selectWindow();
+
+    const AnalyzerKind kind;
+    SpectrumAnalyzerConfig config;
+    DspArena ownArena;
+    DspArena* arena;
+    bool configured;         // False after a configure() that ran out of arena: analyze() publishes nothing
+    kiss_fftr_cfg fftCfg;    // Plan and spectrum live in *arena
+    SizedFftFunction sizedTransform; // Used instead of fftCfg (then null) when the size has one
+    kiss_fft_cpx* fftOutput;
+    StftAccumulator stft;    // Circular history of fftSize samples, one FFT per hop
+    float* windowTables[kWindowTypeCount]; // fftSize coefficients each in *arena; none for kWindowRect
+    float coherentGains[kWindowTypeCount]; // Mean of each table, the window's gain for a tone
+    const float* window;     // Table the STFT applies, nullptr when unwindowed
+    float magnitudeScale;    // 1 / (fftSize x the window's coherent gain): tone magnitudes match the unwindowed ones
+
+    // Fixed point only; the float plan, spectrum, STFT and tables above stay null, and the other way round
+    FixedFftPlan* fixedCfg;  // In *arena, as fftCfg
+    FixedComplex* fixedOutput; // The float spectrum / fftSize
+    BasicStftAccumulator<int16_t> fixedStft;
+    int16_t* fixedWindowTables[kWindowTypeCount]; // Q15; coherentGains holds their gains
+    const int16_t* fixedWindow;
+    float* fixedMagnitude;   // approxMagnitudeQ15() per bin, indexed by bin
+    float fixedFrameScale;   // Scale of fixedMagnitude for the current hop: gain, normalization, window
+    float* previousMagnitude; // fftSize / 2 magnitudes of the last hop in *arena, for the flux
+    bool fluxPrimed;          // False until previousMagnitude holds a real hop
+    NoiseFloor noiseFloor;    // One bin per FFT bin below Nyquist
+    int roadBinEnd;           // First bin above roadNoiseMaxHz
+    int lowBinStart;         // First and one-past-last FFT bin of the low band
+    int lowBinEnd;
+    int highBinStart;        // FFT bin stored in highFreqMagnitude[0]
+    BandReducer fingerBands; // 5 log-spaced bands over highFreqMagnitude, up to fingerTopHz
+    BinSegment segments[kMaxSegments];
+    int segmentCount;
+};
@@ -0,0 +1,79 @@
+#define LOG_TAG "SpectrumKernels"
+
+#include "SpectrumKernelsImpl.h"
+#include "DspLog.h"
+#include <atomic>
+#include <cstring>
+
+#if defined(__arm__) && defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12) // asm/hwcap.h
+#endif
+#endif
+
+namespace {
+
+constexpr int kMaxVariants = 5;
+
+std::atomic<const SpectrumKernelTable*> activeKernels(nullptr);
+
+// Whether the CPU can run a build compiled for more than the ABI's baseline.
+// armeabi-v7a's baseline has NEON, but a few v7 cores lack it; those get the
+// VFP-only build.
+bool cpuSupports(const SpectrumKernelTable* kernels) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (kernels == spectrumKernelsAvx2()) {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2"); // Also checks the OS saves the YMM registers
+    }
+#elif defined(__arm__)
+    if (kernels == spectrumKernelsNeon()) {
+#if defined(__linux__)
+        return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#else
+        return false;
+#endif
+    }
+#endif
+    (void)kernels;
+    return true;
+}
+
+} // namespace
+
+int spectrumKernelVariants(const SpectrumKernelTable** variants, int maxVariants) {
+    const SpectrumKernelTable* builds[kMaxVariants] = {spectrumKernelsAvx2(), spectrumKernelsNeon(),
+                                                       spectrumKernelsSse2(), spectrumKernelsVfp(),
+                                                       spectrumKernelsScalar()};
+    int count = 0;
+    for (const SpectrumKernelTable* kernels : builds) {
+        if (count < maxVariants && kernels && cpuSupports(kernels)) variants[count++] = kernels;
+    }
+    return count;
+}
+
+const SpectrumKernelTable& selectSpectrumKernels() {
+    const SpectrumKernelTable* best = spectrumKernelsScalar();
+    spectrumKernelVariants(&best, 1);
+    activeKernels.store(best, std::memory_order_relaxed);
+    return *best;
+}
+
+bool selectSpectrumKernels(const char* variant) {
+    const SpectrumKernelTable* variants[kMaxVariants];
+    int count = spectrumKernelVariants(variants, kMaxVariants);
+    for (int i = 0; i < count; i++) {
+        if (std::strcmp(variants[i]->variant, variant) == 0) {
+            activeKernels.store(variants[i], std::memory_order_relaxed);
+            return true;
+        }
+    }
+    LOGW("Spectrum kernels '%s' not available on this CPU", variant);
+    return false;
+}
+
+const SpectrumKernelTable& spectrumKernels() {
+    const SpectrumKernelTable* kernels = activeKernels.load(std::memory_order_relaxed);
+    return kernels ? *kernels : selectSpectrumKernels();
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "kissfft/kiss_fft.h"
+#include "NoiseFloor.h"
+
+// Vectorized loops of the analysis hop. magnitudeKernel() does everything
+// processFrequencies() needs from a bin in one pass: |X| (or a magnitude the
+// fixed-point path already approximated), the noise floor subtraction, the
+// onset flux, the band sensitivity, the cap and the peak.
+// Bins are handed over in segments that share their parameters, so the loop
+// body has no per-bin branches. scaleFrame() is the STFT unroll's gain and
+// window, dotProduct() the band reduction and clampCopy() the copies out to
+// Java.
+//
+// Each kernel is built once per instruction set the ABI can have (one
+// SpectrumKernels*.cpp each, with its own target flags): NEON on arm64; NEON
+// and VFP-only on armeabi-v7a; AVX2 and SSE2 on x86_64; plain C++ everywhere.
+// selectSpectrumKernels() picks the best one the CPU runs; the free functions
+// below call through it.
+
+// A run of FFT bins that share their parameters
+struct MagnitudeSegment {
+    int begin;            // FFT bins [begin, end)
+    int end;
+    float* out;           // out[0] gets bin begin; null to only track the bins (flux, noise floor)
+    float sensitivity;
+    float oversubtraction; // Noise floor multiple to subtract
+};
+
+// Parameters shared by every segment of a hop
+struct MagnitudeParams {
+    float scale;                    // |X| to magnitude: 1 / (fftSize x window coherent gain)
+    float cap;                      // Stored values are capped here
+    float* previous;                // Last hop's magnitudes, indexed by bin; updated for the flux
+    const NoiseFloor::Lanes* noise; // Null to skip the subtraction
+    float spectralFloor;
+    const float* magnitudes;        // If set, |X| per bin, used instead of the spectrum (which may be null)
+};
+
+// One build of the kernels
+struct SpectrumKernelTable {
+    const char* variant; // "neon", "vfp", "avx2", "sse2" or "scalar"
+
+    // Runs segment and returns the largest value stored to segment.out (0 if
+    // none). *flux accumulates the rises in magnitude since the last hop.
+    // spectrum is only read if params.magnitudes is null.
+    float (*magnitude)(const kiss_fft_cpx* spectrum, const MagnitudeSegment& segment, const MagnitudeParams& params,
+                       float* flux);
+
+    // dst[i] = src[i] x gain x window[i]; window may be null
+    void (*scaleFrame)(float* dst, const float* src, int count, float gain, const float* window);
+
+    // Sum of a[i] x b[i]
+    float (*dotProduct)(const float* a, const float* b, int count);
+
+    // dst[i] = src[i] clamped to [minValue, maxValue]
+    void (*clampCopy)(float* dst, const float* src, int count, float minValue, float maxValue);
+};
+
+// The builds this CPU can run, fastest first; the last is always the plain
+// C++ one, which matches the loops the kernels replaced bit for bit.
+// Returns how many were written to variants (at most maxVariants).
+int spectrumKernelVariants(const SpectrumKernelTable** variants, int maxVariants);
+
+// Picks the fastest build the CPU runs. Called from JNI_OnLoad; the first
+// kernel call does it otherwise.
+const SpectrumKernelTable& selectSpectrumKernels();
+
+// Uses the named build (benchmarks and replays); false if the CPU cannot run
+// it or it was not built for this ABI
+bool selectSpectrumKernels(const char* variant);
+
+// The build in use
+const SpectrumKernelTable& spectrumKernels();
+
+inline float magnitudeKernel(const kiss_fft_cpx* spectrum, const MagnitudeSegment& segment,
+                             const MagnitudeParams& params, float* flux) {
+    return spectrumKernels().magnitude(spectrum, segment, params, flux);
+}
+
+inline void scaleFrame(float* dst, const float* src, int count, float gain, const float* window) {
+    spectrumKernels().scaleFrame(dst, src, count, gain, window);
+}
+
+inline float dotProduct(const float* a, const float* b, int count) {
+    return spectrumKernels().dotProduct(a, b, count);
+}
+
+inline void clampCopy(float* dst, const float* src, int count, float minValue, float maxValue) {
+    spectrumKernels().clampCopy(dst, src, count, minValue, maxValue);
+}
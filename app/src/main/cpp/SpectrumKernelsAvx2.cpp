@@ -0,0 +1,54 @@
+// AVX2 build of the spectrum kernels, compiled with -mavx2 on x86 (see
+// CMakeLists.txt) and picked when the CPU and OS support AVX2. No -mfma, so
+// every lane rounds exactly like the SSE2 and scalar builds.
+#include "SpectrumKernelsImpl.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace {
+
+struct Avx2Lanes {
+    using Reg = __m256;
+    static constexpr int kWidth = 8;
+    static Reg set(float v) { return _mm256_set1_ps(v); }
+    static Reg load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, Reg v) { _mm256_storeu_ps(p, v); }
+    static void loadComplex(const kiss_fft_cpx* p, Reg& re, Reg& im) {
+        const float* f = reinterpret_cast<const float*>(p);
+        __m256 a = _mm256_loadu_ps(f);     // r0 i0 r1 i1 | r2 i2 r3 i3
+        __m256 b = _mm256_loadu_ps(f + 8); // r4 i4 r5 i5 | r6 i6 r7 i7
+        // Shuffles work within 128-bit halves: r0 r1 r4 r5 | r2 r3 r6 r7, then put the halves in order
+        re = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, 0x88)), 0xD8));
+        im = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, 0xDD)), 0xD8));
+    }
+    static Reg add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+    static Reg sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+    static Reg min(Reg a, Reg b) { return _mm256_min_ps(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm256_max_ps(a, b); }
+    static Reg sqrt(Reg a) { return _mm256_sqrt_ps(a); }
+    static float sum(Reg a) {
+        __m128 half = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+        half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+        return _mm_cvtss_f32(_mm_add_ss(half, _mm_shuffle_ps(half, half, 1)));
+    }
+    static float maxOf(Reg a) {
+        __m128 half = _mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+        half = _mm_max_ps(half, _mm_movehl_ps(half, half));
+        return _mm_cvtss_f32(_mm_max_ss(half, _mm_shuffle_ps(half, half, 1)));
+    }
+};
+
+constexpr SpectrumKernelTable kAvx2Kernels = kernelTable<Avx2Lanes>("avx2");
+
+} // namespace
+
+const SpectrumKernelTable* spectrumKernelsAvx2() {
+    return &kAvx2Kernels;
+}
+#else
+const SpectrumKernelTable* spectrumKernelsAvx2() {
+    return nullptr;
+}
+#endif
@@ -0,0 +1,179 @@
+#pragma once
+
+// The kernel bodies behind SpectrumKernelTable, written once over a "lanes"
+// type that wraps one register type and the handful of operations they need.
+// Each SpectrumKernels<Variant>.cpp defines its lanes and includes this with
+// its own target flags, so everything here is in an anonymous namespace: one
+// private copy per variant, none of which the linker can swap for another
+// (an AVX2 build of a shared inline function would otherwise end up called
+// on CPUs without AVX2). For the same reason nothing here calls inline
+// library code such as std::min.
+
+#include "SpectrumKernels.h"
+#include <cmath>
+
+// Each variant's table, or null if it was not built for this ABI
+const SpectrumKernelTable* spectrumKernelsNeon();
+const SpectrumKernelTable* spectrumKernelsAvx2();
+const SpectrumKernelTable* spectrumKernelsSse2();
+const SpectrumKernelTable* spectrumKernelsVfp();
+const SpectrumKernelTable* spectrumKernelsScalar();
+
+namespace {
+
+// std::min and std::max, operand order included
+inline float laneMin(float a, float b) { return b < a ? b : a; }
+inline float laneMax(float a, float b) { return a < b ? b : a; }
+
+struct ScalarLanes {
+    using Reg = float;
+    static constexpr int kWidth = 1;
+    static Reg set(float v) { return v; }
+    static Reg load(const float* p) { return *p; }
+    static void store(float* p, Reg v) { *p = v; }
+    static void loadComplex(const kiss_fft_cpx* p, Reg& re, Reg& im) {
+        re = p->r;
+        im = p->i;
+    }
+    static Reg add(Reg a, Reg b) { return a + b; }
+    static Reg sub(Reg a, Reg b) { return a - b; }
+    static Reg mul(Reg a, Reg b) { return a * b; }
+    static Reg min(Reg a, Reg b) { return laneMin(a, b); }
+    static Reg max(Reg a, Reg b) { return laneMax(a, b); }
+    static Reg sqrt(Reg a) { return sqrtf(a); }
+    static float sum(Reg a) { return a; }
+    static float maxOf(Reg a) { return a; }
+};
+
+// Bins [i, end) in steps of L::kWidth; returns the first bin not processed.
+// The operations and their order match NoiseFloor::track() and subtract(), so
+// ScalarLanes reproduces the original per-bin loop exactly. Precomputed reads
+// |X| from params.magnitudes instead of the spectrum.
+template <typename L, bool Precomputed, bool Denoise, bool Store>
+int runLanes(const kiss_fft_cpx* spectrum, int i, const MagnitudeSegment& segment, const MagnitudeParams& params,
+             typename L::Reg& flux, typename L::Reg& peak) {
+    using Reg = typename L::Reg;
+    const Reg zero = L::set(0.0f);
+    const Reg scale = L::set(params.scale);
+    const Reg cap = L::set(params.cap);
+    const Reg sensitivity = L::set(segment.sensitivity);
+    const Reg oversubtraction = L::set(segment.oversubtraction);
+    const Reg spectralFloor = L::set(params.spectralFloor);
+    const Reg bias = L::set(NoiseFloor::kBias);
+    const Reg smoothing = L::set(Denoise ? params.noise->smoothing : 0.0f);
+    float* out = Store ? segment.out - segment.begin : nullptr; // Indexed by bin
+    for (; i + L::kWidth <= segment.end; i += L::kWidth) {
+        Reg magnitude;
+        if (Precomputed) {
+            magnitude = L::mul(L::load(params.magnitudes + i), scale);
+        } else {
+            Reg re, im;
+            L::loadComplex(spectrum + i, re, im);
+            magnitude = L::mul(L::sqrt(L::add(L::mul(re, re), L::mul(im, im))), scale);
+        }
+        if (Denoise) {
+            const NoiseFloor::Lanes& noise = *params.noise;
+            Reg smoothed = L::load(noise.smoothedMagnitude + i);
+            smoothed = L::add(smoothed, L::mul(smoothing, L::sub(magnitude, smoothed)));
+            L::store(noise.smoothedMagnitude + i, smoothed);
+            Reg current = L::min(L::load(noise.currentMinimum + i), smoothed);
+            L::store(noise.currentMinimum + i, current);
+            Reg floor = L::mul(bias, L::min(L::load(noise.windowMinimum + i), current));
+            magnitude = L::max(L::sub(magnitude, L::mul(oversubtraction, floor)), L::mul(spectralFloor, magnitude));
+        }
+        flux = L::add(flux, L::max(zero, L::sub(magnitude, L::load(params.previous + i))));
+        L::store(params.previous + i, magnitude);
+        if (Store) {
+            Reg value = L::min(L::mul(magnitude, sensitivity), cap);
+            L::store(out + i, value);
+            peak = L::max(peak, value);
+        }
+    }
+    return i;
+}
+
+// Vector lanes for the bulk, scalar for the tail
+template <typename L, bool Precomputed, bool Denoise, bool Store>
+float runSegment(const kiss_fft_cpx* spectrum, const MagnitudeSegment& segment, const MagnitudeParams& params,
+                 float* flux) {
+    float fluxTail = *flux; // Scalar lanes accumulate straight into it, in the original order
+    float peak = 0.0f;
+    int i = segment.begin;
+    if (L::kWidth > 1) {
+        typename L::Reg fluxLanes = L::set(0.0f);
+        typename L::Reg peakLanes = L::set(0.0f);
+        i = runLanes<L, Precomputed, Denoise, Store>(spectrum, i, segment, params, fluxLanes, peakLanes);
+        fluxTail += L::sum(fluxLanes);
+        peak = L::maxOf(peakLanes);
+    }
+    runLanes<ScalarLanes, Precomputed, Denoise, Store>(spectrum, i, segment, params, fluxTail, peak);
+    *flux = fluxTail;
+    return peak;
+}
+
+template <typename L, bool Precomputed>
+float magnitudeFrom(const kiss_fft_cpx* spectrum, const MagnitudeSegment& segment, const MagnitudeParams& params,
+                    float* flux) {
+    if (params.noise) {
+        return segment.out ? runSegment<L, Precomputed, true, true>(spectrum, segment, params, flux)
+                           : runSegment<L, Precomputed, true, false>(spectrum, segment, params, flux);
+    }
+    return segment.out ? runSegment<L, Precomputed, false, true>(spectrum, segment, params, flux)
+                       : runSegment<L, Precomputed, false, false>(spectrum, segment, params, flux);
+}
+
+template <typename L>
+float magnitude(const kiss_fft_cpx* spectrum, const MagnitudeSegment& segment, const MagnitudeParams& params,
+                float* flux) {
+    if (segment.end <= segment.begin) return 0.0f;
+    return params.magnitudes ? magnitudeFrom<L, true>(spectrum, segment, params, flux)
+                             : magnitudeFrom<L, false>(spectrum, segment, params, flux);
+}
+
+// Gain first, then the window, as the STFT unroll always did
+template <typename L>
+void scaleFrame(float* dst, const float* src, int count, float gain, const float* window) {
+    const typename L::Reg scale = L::set(gain);
+    int i = 0;
+    if (window) {
+        for (; i + L::kWidth <= count; i += L::kWidth) {
+            L::store(dst + i, L::mul(L::mul(L::load(src + i), scale), L::load(window + i)));
+        }
+        for (; i < count; i++) dst[i] = src[i] * gain * window[i];
+    } else {
+        for (; i + L::kWidth <= count; i += L::kWidth) L::store(dst + i, L::mul(L::load(src + i), scale));
+        for (; i < count; i++) dst[i] = src[i] * gain;
+    }
+}
+
+// One partial sum per lane; with ScalarLanes the original left-to-right sum
+template <typename L>
+float dotProduct(const float* a, const float* b, int count) {
+    float acc = 0.0f;
+    int i = 0;
+    if (L::kWidth > 1) {
+        typename L::Reg lanes = L::set(0.0f);
+        for (; i + L::kWidth <= count; i += L::kWidth) lanes = L::add(lanes, L::mul(L::load(a + i), L::load(b + i)));
+        acc = L::sum(lanes);
+    }
+    for (; i < count; i++) acc += a[i] * b[i];
+    return acc;
+}
+
+template <typename L>
+void clampCopy(float* dst, const float* src, int count, float minValue, float maxValue) {
+    const typename L::Reg lower = L::set(minValue);
+    const typename L::Reg upper = L::set(maxValue);
+    int i = 0;
+    for (; i + L::kWidth <= count; i += L::kWidth) {
+        L::store(dst + i, L::max(lower, L::min(L::load(src + i), upper)));
+    }
+    for (; i < count; i++) dst[i] = laneMax(minValue, laneMin(src[i], maxValue));
+}
+
+template <typename L>
+constexpr SpectrumKernelTable kernelTable(const char* variant) {
+    return {variant, magnitude<L>, scaleFrame<L>, dotProduct<L>, clampCopy<L>};
+}
+
+} // namespace
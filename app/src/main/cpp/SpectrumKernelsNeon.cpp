@@ -0,0 +1,61 @@
+// NEON build of the spectrum kernels: the baseline on arm64 and armeabi-v7a,
+// picked on v7 when HWCAP_NEON is set
+#include "SpectrumKernelsImpl.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+
+namespace {
+
+struct NeonLanes {
+    using Reg = float32x4_t;
+    static constexpr int kWidth = 4;
+    static Reg set(float v) { return vdupq_n_f32(v); }
+    static Reg load(const float* p) { return vld1q_f32(p); }
+    static void store(float* p, Reg v) { vst1q_f32(p, v); }
+    static void loadComplex(const kiss_fft_cpx* p, Reg& re, Reg& im) {
+        float32x4x2_t pair = vld2q_f32(reinterpret_cast<const float*>(p)); // De-interleaves r and i
+        re = pair.val[0];
+        im = pair.val[1];
+    }
+    static Reg add(Reg a, Reg b) { return vaddq_f32(a, b); }
+    static Reg sub(Reg a, Reg b) { return vsubq_f32(a, b); }
+    static Reg mul(Reg a, Reg b) { return vmulq_f32(a, b); }
+    static Reg min(Reg a, Reg b) { return vminq_f32(a, b); }
+    static Reg max(Reg a, Reg b) { return vmaxq_f32(a, b); }
+#if defined(__aarch64__)
+    static Reg sqrt(Reg a) { return vsqrtq_f32(a); }
+    static float sum(Reg a) { return vaddvq_f32(a); }
+    static float maxOf(Reg a) { return vmaxvq_f32(a); }
+#else
+    // ARMv7 NEON has no vector square root: reciprocal square root estimate,
+    // two Newton steps (~1 ulp), times a; zero would give 0 x inf
+    static Reg sqrt(Reg a) {
+        float32x4_t estimate = vrsqrteq_f32(a);
+        estimate = vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(a, estimate), estimate));
+        estimate = vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(a, estimate), estimate));
+        return vbslq_f32(vceqq_f32(a, vdupq_n_f32(0.0f)), vdupq_n_f32(0.0f), vmulq_f32(a, estimate));
+    }
+    static float sum(Reg a) {
+        float32x2_t half = vadd_f32(vget_low_f32(a), vget_high_f32(a));
+        return vget_lane_f32(vpadd_f32(half, half), 0);
+    }
+    static float maxOf(Reg a) {
+        float32x2_t half = vmax_f32(vget_low_f32(a), vget_high_f32(a));
+        return vget_lane_f32(vpmax_f32(half, half), 0);
+    }
+#endif
+};
+
+constexpr SpectrumKernelTable kNeonKernels = kernelTable<NeonLanes>("neon");
+
+} // namespace
+
+const SpectrumKernelTable* spectrumKernelsNeon() {
+    return &kNeonKernels;
+}
+#else
+const SpectrumKernelTable* spectrumKernelsNeon() {
+    return nullptr;
+}
+#endif
@@ -0,0 +1,13 @@
+// Plain C++ build of the spectrum kernels, on every ABI: the reference the
+// others are checked against
+#include "SpectrumKernelsImpl.h"
+
+namespace {
+
+constexpr SpectrumKernelTable kScalarKernels = kernelTable<ScalarLanes>("scalar");
+
+} // namespace
+
+const SpectrumKernelTable* spectrumKernelsScalar() {
+    return &kScalarKernels;
+}
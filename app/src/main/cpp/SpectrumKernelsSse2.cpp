@@ -0,0 +1,49 @@
+// SSE2 build of the spectrum kernels: the x86_64 baseline
+#include "SpectrumKernelsImpl.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+namespace {
+
+struct Sse2Lanes {
+    using Reg = __m128;
+    static constexpr int kWidth = 4;
+    static Reg set(float v) { return _mm_set1_ps(v); }
+    static Reg load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, Reg v) { _mm_storeu_ps(p, v); }
+    static void loadComplex(const kiss_fft_cpx* p, Reg& re, Reg& im) {
+        const float* f = reinterpret_cast<const float*>(p);
+        __m128 a = _mm_loadu_ps(f);     // r0 i0 r1 i1
+        __m128 b = _mm_loadu_ps(f + 4); // r2 i2 r3 i3
+        re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    }
+    static Reg add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+    static Reg sub(Reg a, Reg b) { return _mm_sub_ps(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+    static Reg min(Reg a, Reg b) { return _mm_min_ps(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm_max_ps(a, b); }
+    static Reg sqrt(Reg a) { return _mm_sqrt_ps(a); }
+    static float sum(Reg a) {
+        a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+        return _mm_cvtss_f32(_mm_add_ss(a, _mm_shuffle_ps(a, a, 1)));
+    }
+    static float maxOf(Reg a) {
+        a = _mm_max_ps(a, _mm_movehl_ps(a, a));
+        return _mm_cvtss_f32(_mm_max_ss(a, _mm_shuffle_ps(a, a, 1)));
+    }
+};
+
+constexpr SpectrumKernelTable kSse2Kernels = kernelTable<Sse2Lanes>("sse2");
+
+} // namespace
+
+const SpectrumKernelTable* spectrumKernelsSse2() {
+    return &kSse2Kernels;
+}
+#else
+const SpectrumKernelTable* spectrumKernelsSse2() {
+    return nullptr;
+}
+#endif
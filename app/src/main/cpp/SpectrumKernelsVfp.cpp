@@ -0,0 +1,21 @@
+// VFP-only build of the spectrum kernels for armeabi-v7a cores without NEON:
+// the plain C++ lanes, compiled with -mfpu=vfpv3-d16 (see CMakeLists.txt) so
+// the compiler cannot vectorize them with NEON as it may the scalar build
+#include "SpectrumKernelsImpl.h"
+
+#if defined(__arm__) && !defined(__ARM_NEON) && !defined(__ARM_NEON__)
+
+namespace {
+
+constexpr SpectrumKernelTable kVfpKernels = kernelTable<ScalarLanes>("vfp");
+
+} // namespace
+
+const SpectrumKernelTable* spectrumKernelsVfp() {
+    return &kVfpKernels;
+}
+#else
+const SpectrumKernelTable* spectrumKernelsVfp() {
+    return nullptr;
+}
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Lock-free single-producer/single-consumer ring of samples. The audio callback
+// writes, the analysis worker reads. Capacity is rounded up to a power of two.
+// Writes that do not fit are truncated rather than overwriting unread data.
+template <typename T>
+class SpscRingBuffer {
+public:
+    explicit SpscRingBuffer(uint32_t minCapacity) : writeIndex(0), readIndex(0) {
+        uint32_t capacity = 1;
+        while (capacity < minCapacity) capacity <<= 1;
+        buffer.resize(capacity);
+        mask = capacity - 1;
+    }
+
+    uint32_t capacity() const { return mask + 1; }
+
+    uint32_t availableToRead() const {
+        return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_relaxed);
+    }
+
+    // Producer side: returns the number of items actually written
+    uint32_t write(const T* data, uint32_t count) {
+        uint32_t write = writeIndex.load(std::memory_order_relaxed);
+        uint32_t read = readIndex.load(std::memory_order_acquire);
+        uint32_t space = capacity() - (write - read);
+        if (count > space) count = space;
+        for (uint32_t i = 0; i < count; i++) {
+            buffer[(write + i) & mask] = data[i];
+        }
+        writeIndex.store(write + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer side: returns the number of items actually read
+    uint32_t read(T* data, uint32_t count) {
+        uint32_t read = readIndex.load(std::memory_order_relaxed);
+        uint32_t available = writeIndex.load(std::memory_order_acquire) - read;
+        if (count > available) count = available;
+        for (uint32_t i = 0; i < count; i++) {
+            data[i] = buffer[(read + i) & mask];
+        }
+        readIndex.store(read + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer side: drops everything currently buffered
+    void clear() {
+        readIndex.store(writeIndex.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    std::vector<T> buffer;
+    uint32_t mask;
+    // Separate cache lines so producer and consumer do not false-share
+    alignas(64) std::atomic<uint32_t> writeIndex;
+    alignas(64) std::atomic<uint32_t> readIndex;
+};
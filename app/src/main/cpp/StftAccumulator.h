@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include "FixedPoint.h"
+#include "SpectrumKernels.h"
+
+// Per-sample-type parts of the STFT: the copy into the history with the hop's
+// energy, and the mean square the AGC sees (always relative to full scale 1.0)
+template <typename Sample>
+struct StftSamples;
+
+template <>
+struct StftSamples<float> {
+    using Energy = float;
+
+    static float meanSquare(float energy, int samples) { return energy / samples; }
+
+    // Copies count samples and returns their sum of squares. Four independent
+    // partial sums let the compiler keep the accumulation in a vector register
+    // without reassociating floating-point adds.
+    static float copyWithEnergy(float* dst, const float* src, int count) {
+        float sums[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            for (int k = 0; k < 4; k++) {
+                dst[i + k] = src[i + k];
+                sums[k] += src[i + k] * src[i + k];
+            }
+        }
+        float energy = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+        for (; i < count; i++) {
+            dst[i] = src[i];
+            energy += src[i] * src[i];
+        }
+        return energy;
+    }
+};
+
+template <>
+struct StftSamples<int16_t> {
+    using Energy = int64_t; // Exact; a hop of full-scale samples needs 30 bits per sample
+
+    static float meanSquare(int64_t energy, int samples) {
+        return static_cast<float>(static_cast<double>(energy) / samples / (kPcm16FullScale * kPcm16FullScale));
+    }
+
+    static int64_t copyWithEnergy(int16_t* dst, const int16_t* src, int count) {
+        int64_t energy = 0;
+        for (int i = 0; i < count; i++) {
+            dst[i] = src[i];
+            energy += src[i] * src[i];
+        }
+        return energy;
+    }
+};
+
+// Streaming short-time Fourier transform front end. Keeps a circular history of
+// the last fftSize samples and emits one contiguous, oldest-first frame every
+// hopSize samples, however the input is split into callbacks. The two
+// fftSize-sample buffers belong to the caller (SpectrumAnalyzer's arena).
+// Sample is float, or int16_t for the fixed-point FFT.
+template <typename Sample>
+class BasicStftAccumulator {
+public:
+    BasicStftAccumulator()
+            : fftSize(0), hopSize(1), writePos(0), samplesUntilHop(1), hopEnergy(0), hopSamples(0),
+              hopMeanSquare(0.0f), history(nullptr), frame(nullptr) {}
+
+    void configure(int size, int hop, Sample* historyBuffer, Sample* frameBuffer) {
+        fftSize = size;
+        hopSize = clampHop(hop, size);
+        history = historyBuffer;
+        frame = frameBuffer;
+        reset();
+    }
+
+    int getFftSize() const { return fftSize; }
+    int getHopSize() const { return hopSize; }
+
+    // Takes effect from the next hop boundary
+    void setHopSize(int hop) {
+        hopSize = clampHop(hop, fftSize);
+        samplesUntilHop = std::min(samplesUntilHop, hopSize);
+    }
+
+    void reset() {
+        std::fill(history, history + fftSize, Sample());
+        writePos = 0;
+        samplesUntilHop = hopSize;
+        hopEnergy = 0;
+        hopSamples = 0;
+        hopMeanSquare = 0.0f;
+    }
+
+    // Mean square of the raw input over the hop that completed the current
+    // frame, full scale being 1.0 whatever the sample type; valid inside onFrame
+    float getHopMeanSquare() const { return hopMeanSquare; }
+
+    // Appends count raw samples and calls onFrame(float* frame) for every
+    // completed hop with the frame scaled by gain and, unless window is null,
+    // multiplied by the fftSize-float window; the frame is scratch and may be
+    // modified in place. gain is read at every hop, so onFrame may change it.
+    // Returns the number of frames emitted.
+    template <typename OnFrame>
+    int push(const Sample* input, int32_t count, const float& gain, const float* window, OnFrame&& onFrame) {
+        return pushHops(input, count, [&]() {
+            // Unroll the circular history so the oldest sample comes first,
+            // applying the gain and the window on the way: one pass over the
+            // frame whether or not it is windowed
+            const float scale = gain;
+            const int tail = fftSize - writePos;
+            scaleFrame(frame, history + writePos, tail, scale, window);
+            scaleFrame(frame + tail, history, writePos, scale, window ? window + tail : nullptr);
+            onFrame(frame);
+        });
+    }
+
+    // The int16 counterpart: each frame is multiplied by the Q15 window
+    // (unless null) and then normalized, and onFrame(int16_t* frame, int shift)
+    // gets it with the left shift normalizeFrame() applied. There is no gain;
+    // the caller applies it to the transform, where it cannot clip.
+    template <typename OnFrame>
+    int pushNormalized(const Sample* input, int32_t count, const int16_t* window, OnFrame&& onFrame) {
+        return pushHops(input, count, [&]() {
+            const int tail = fftSize - writePos;
+            int peak = windowFrameQ15(frame, history + writePos, tail, window);
+            peak = std::max(peak, windowFrameQ15(frame + tail, history, writePos, window ? window + tail : nullptr));
+            int shift = normalizeFrame(frame, fftSize, peak);
+            onFrame(frame, shift);
+        });
+    }
+
+private:
+    static int clampHop(int hop, int size) { return std::max(1, std::min(hop, size)); }
+
+    // Appends the input and calls unroll() at every hop boundary, with the
+    // hop's mean square already set
+    template <typename Unroll>
+    int pushHops(const Sample* input, int32_t count, Unroll&& unroll) {
+        int frames = 0;
+        while (count > 0) {
+            int chunk = std::min<int32_t>(count, samplesUntilHop);
+            int first = std::min(chunk, fftSize - writePos);
+            hopEnergy += StftSamples<Sample>::copyWithEnergy(history + writePos, input, first);
+            hopEnergy += StftSamples<Sample>::copyWithEnergy(history, input + first, chunk - first);
+            hopSamples += chunk;
+            writePos = (writePos + chunk) % fftSize;
+            input += chunk;
+            count -= chunk;
+            samplesUntilHop -= chunk;
+
+            if (samplesUntilHop == 0) {
+                hopMeanSquare = StftSamples<Sample>::meanSquare(hopEnergy, hopSamples);
+                hopEnergy = 0;
+                hopSamples = 0;
+                unroll();
+                samplesUntilHop = hopSize;
+                frames++;
+            }
+        }
+        return frames;
+    }
+
+    int fftSize;
+    int hopSize;
+    int writePos;
+    int samplesUntilHop;
+    typename StftSamples<Sample>::Energy hopEnergy; // Sum of squares of the raw input since the last hop
+    int hopSamples;
+    float hopMeanSquare;
+    Sample* history;     // Raw input; the gain is applied when a frame is unrolled
+    Sample* frame;
+};
+
+using StftAccumulator = BasicStftAccumulator<float>;
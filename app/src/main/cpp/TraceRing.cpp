@@ -0,0 +1,118 @@
+#define LOG_TAG "DspTrace"
+
+#include "TraceRing.h"
+#include "DspLog.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+TraceRing& dspTrace() {
+    static TraceRing ring;
+    return ring;
+}
+
+size_t TraceRing::readSince(uint64_t* cursor, TraceEntry* out, size_t maxEntries, uint64_t* dropped) const {
+    uint64_t end = head.load(std::memory_order_acquire);
+    if (end - *cursor > kCapacity) {
+        if (dropped) *dropped += end - kCapacity - *cursor;
+        *cursor = end - kCapacity;
+    }
+    size_t count = 0;
+    while (*cursor < end && count < maxEntries) {
+        const Slot& slot = slots[*cursor & (kCapacity - 1)];
+        uint64_t before = slot.stamp.load(std::memory_order_acquire);
+        if (before == 0 || before < *cursor + 1) {
+            break; // Claimed but not yet complete; pick it up next time
+        }
+        TraceEntry copy = slot.entry;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (before == *cursor + 1 && slot.stamp.load(std::memory_order_relaxed) == before) {
+            out[count++] = copy;
+        } else if (dropped) {
+            (*dropped)++; // Overwritten while we were behind
+        }
+        (*cursor)++;
+    }
+    return count;
+}
+
+void TraceRing::format(const TraceEntry& entry, char* buffer, size_t size) {
+    switch (entry.event) {
+        case kTraceSpectrum:
+            snprintf(buffer, size, "spectrum low[0]=%f high[0]=%f highMax=%f",
+                     entry.values[0], entry.values[1], entry.values[2]);
+            break;
+        case kTraceNoFreshData:
+            snprintf(buffer, size, "no fresh data, buffers unchanged");
+            break;
+        case kTraceRingOverrun:
+            snprintf(buffer, size, "pcm ring overrun: %.0f samples dropped (capacity %.0f)",
+                     entry.values[0], entry.values[1]);
+            break;
+        case kTraceTempoLocked:
+            snprintf(buffer, size, "tempo locked at %.1f BPM, confidence %.2f", entry.values[0], entry.values[1]);
+            break;
+        case kTraceTempoChanged:
+            snprintf(buffer, size, "tempo changed to %.1f BPM, confidence %.2f", entry.values[0], entry.values[1]);
+            break;
+        default:
+            snprintf(buffer, size, "event %u %f %f %f", entry.event,
+                     entry.values[0], entry.values[1], entry.values[2]);
+            break;
+    }
+}
+
+std::string TraceRing::formatRecent(size_t maxEntries) const {
+    maxEntries = std::min<size_t>(maxEntries, kCapacity);
+    uint64_t end = written();
+    uint64_t cursor = end > maxEntries ? end - maxEntries : 0;
+    TraceEntry entries[64];
+    std::string text;
+    char line[160];
+    size_t count;
+    while ((count = readSince(&cursor, entries, 64, nullptr)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            int prefix = snprintf(line, sizeof(line), "%" PRId64 ".%06" PRId64 " ",
+                                  entries[i].timestampNs / 1000000000, (entries[i].timestampNs / 1000) % 1000000);
+            format(entries[i], line + prefix, sizeof(line) - prefix);
+            text += line;
+            text += '\n';
+        }
+    }
+    return text;
+}
+
+void TraceDrainer::start(int intervalMs) {
+#if DSP_LOG_LEVEL >= DSP_LOG_LEVEL_INFO
+    if (running.exchange(true)) return;
+    thread = std::thread(&TraceDrainer::drainLoop, this, intervalMs);
+#else
+    (void) intervalMs;
+#endif
+}
+
+void TraceDrainer::stop() {
+    if (!running.exchange(false)) return;
+    if (thread.joinable()) thread.join();
+}
+
+void TraceDrainer::drainLoop(int intervalMs) {
+    uint64_t cursor = dspTrace().written();
+    uint64_t dropped = 0;
+    TraceEntry entries[64];
+    char line[128];
+    while (running.load(std::memory_order_acquire)) {
+        size_t count;
+        while ((count = dspTrace().readSince(&cursor, entries, 64, &dropped)) > 0) {
+            for (size_t i = 0; i < count; i++) {
+                TraceRing::format(entries[i], line, sizeof(line));
+                LOGI("%s", line);
+            }
+        }
+        if (dropped > 0) {
+            LOGW("Trace drain fell behind, %llu entries lost", (unsigned long long) dropped);
+            dropped = 0;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+// Binary diagnostics from the hot path. Each write is a fetch_add and a 32-byte
+// store: no locks, no formatting and no syscalls, so the audio callback and the
+// analysis worker can trace every hop. Text is produced later by TraceDrainer or
+// on demand by formatRecent().
+enum TraceEvent : uint32_t {
+    kTraceSpectrum = 1,   // lowFreq[0], highFreq[0], highFreq max
+    kTraceNoFreshData,    // getBandFrame polled before a new spectrum was published
+    kTraceRingOverrun,    // Samples dropped, ring capacity
+    kTraceTempoLocked,    // BPM, confidence
+    kTraceTempoChanged,   // BPM, confidence
+    kTraceEventCount
+};
+
+struct TraceEntry {
+    int64_t timestampNs;
+    uint32_t event;
+    float values[3];
+};
+
+class TraceRing {
+public:
+    static constexpr uint32_t kCapacity = 1024; // Power of two
+
+    // Any thread; wait-free. A writer lapped by another kCapacity writes loses its entry.
+    void write(uint32_t event, float a = 0.0f, float b = 0.0f, float c = 0.0f) {
+        uint64_t index = head.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = slots[index & (kCapacity - 1)];
+        slot.stamp.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.entry.timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        slot.entry.event = event;
+        slot.entry.values[0] = a;
+        slot.entry.values[1] = b;
+        slot.entry.values[2] = c;
+        slot.stamp.store(index + 1, std::memory_order_release);
+    }
+
+    // Copies entries from *cursor onwards and advances it. Entries already
+    // overwritten are counted in *dropped; stops early at one still being written.
+    size_t readSince(uint64_t* cursor, TraceEntry* out, size_t maxEntries, uint64_t* dropped) const;
+
+    uint64_t written() const { return head.load(std::memory_order_acquire); }
+
+    // The newest maxEntries entries as text lines, oldest first
+    std::string formatRecent(size_t maxEntries) const;
+
+    static void format(const TraceEntry& entry, char* buffer, size_t size);
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> stamp{0}; // index + 1 once the entry is complete, 0 while writing
+        TraceEntry entry;
+    };
+
+    std::atomic<uint64_t> head{0};
+    Slot slots[kCapacity];
+};
+
+// Process-wide ring shared by the analyzer, the pipeline and the JNI layer
+TraceRing& dspTrace();
+
+#ifndef DSP_TRACE_ENABLED
+#define DSP_TRACE_ENABLED 1
+#endif
+
+#if DSP_TRACE_ENABLED
+#define DSP_TRACE(...) dspTrace().write(__VA_ARGS__)
+#else
+#define DSP_TRACE(...) ((void) 0)
+#endif
+
+// Forwards new trace entries to the info log from a background thread, keeping
+// the logging syscalls off the real-time threads. Does nothing when info
+// logging is compiled out; the ring still serves formatRecent().
+class TraceDrainer {
+public:
+    TraceDrainer() = default;
+    ~TraceDrainer() { stop(); }
+
+    TraceDrainer(const TraceDrainer&) = delete;
+    TraceDrainer& operator=(const TraceDrainer&) = delete;
+
+    void start(int intervalMs = 250);
+    void stop();
+
+private:
+    void drainLoop(int intervalMs);
+
+    std::thread thread;
+    std::atomic<bool> running{false};
+};
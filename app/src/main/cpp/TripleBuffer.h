@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Wait-free single-producer/single-consumer hand-off of the latest value.
+// The producer fills back(), then publish() swaps it with the shared middle slot.
+// The consumer calls consume() to swap the middle slot into front() when a newer
+// value has been published. Neither side ever blocks or spins on the other, so it
+// is safe to publish from the real-time audio callback.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : backIndex(0), middle(1), frontIndex(2) {}
+
+    // Producer side
+    T& back() { return slots[backIndex].value; }
+
+    void publish() {
+        uint8_t previous = middle.exchange(static_cast<uint8_t>(backIndex | kFresh), std::memory_order_acq_rel);
+        backIndex = previous & kIndexMask;
+    }
+
+    // Consumer side: returns true if front() now holds a newer value than before
+    bool consume() {
+        if ((middle.load(std::memory_order_relaxed) & kFresh) == 0) {
+            return false;
+        }
+        uint8_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = previous & kIndexMask;
+        return true;
+    }
+
+    const T& front() const { return slots[frontIndex].value; }
+
+    // Not thread-safe: rewrites the consumer's slot too, so only call while
+    // neither side runs
+    void reset(const T& value) {
+        for (Slot& slot : slots) slot.value = value;
+        backIndex = 0;
+        middle.store(1, std::memory_order_release);
+        frontIndex = 2;
+    }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x3;
+    static constexpr uint8_t kFresh = 0x4;
+
+    // Each slot and each index on its own cache line: the producer and the
+    // consumer only ever share the line holding middle
+    struct Slot {
+        alignas(64) T value;
+    };
+
+    Slot slots[3];
+    alignas(64) uint8_t backIndex;
+    alignas(64) std::atomic<uint8_t> middle;
+    alignas(64) uint8_t frontIndex;
+};
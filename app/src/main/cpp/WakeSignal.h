@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Single-waiter wakeup, posted from the real-time audio callback. post() never
+// blocks: it is one atomic exchange, plus a FUTEX_WAKE system call only when
+// the waiter is actually asleep. Posts while nobody waits are remembered, but
+// not counted: the waiter drains everything available each time it wakes.
+class WakeSignal {
+public:
+    WakeSignal() : state(kIdle) {}
+
+    // Any thread
+    void post() {
+        if (state.exchange(kPosted, std::memory_order_release) == kWaiting) {
+            futex(FUTEX_WAKE_PRIVATE, 1, nullptr);
+        }
+    }
+
+    // Waiter side: returns after a post (at once if one is pending) or timeoutNs,
+    // whichever comes first; a spurious early return is possible
+    void wait(int64_t timeoutNs) {
+        if (state.exchange(kIdle, std::memory_order_acquire) == kPosted) return;
+        int expected = kIdle;
+        if (state.compare_exchange_strong(expected, kWaiting, std::memory_order_acquire)) {
+            timespec timeout = {static_cast<time_t>(timeoutNs / 1000000000), static_cast<long>(timeoutNs % 1000000000)};
+            futex(FUTEX_WAIT_PRIVATE, kWaiting, &timeout); // Returns at once if a post got in first
+        }
+        // Consumes whatever post woke us (or came in since), pairing with its release
+        state.exchange(kIdle, std::memory_order_acquire);
+    }
+
+private:
+    enum : int { kIdle = 0, kPosted = 1, kWaiting = 2 };
+
+    void futex(int op, int value, const timespec* timeout) {
+        syscall(SYS_futex, reinterpret_cast<int*>(&state), op, value, timeout, nullptr, 0);
+    }
+
+    static_assert(sizeof(std::atomic<int>) == sizeof(int) && std::atomic<int>::is_always_lock_free,
+                  "futex needs a plain int");
+    std::atomic<int> state;
+};
@@ -0,0 +1,34 @@
+// Both FFT analyzers on a shared arena with no room: configure() must fail
+// and analyze() publish nothing, then both must recover once the arena is
+// reset with room and they are configured again.
+
+#include "DspArena.h"
+#include "HostTest.h"
+#include "SpectrumAnalyzer.h"
+#include "TestSignals.h"
+#include <cstdio>
+#include <vector>
+
+bool testArenaFailure() {
+    SpectrumAnalyzerConfig config;
+    std::vector<float> signal(config.fftSize * 4);
+    fillSignal(signal.data(), static_cast<int>(signal.size()), config.sampleRate);
+    bool pass = true;
+    for (AnalyzerKind kind : {kAnalyzerFft, kAnalyzerFixedFft}) {
+        DspArena arena;
+        SpectrumAnalyzer analyzer(config, &arena, kind);
+        bool failed = !analyzer.configure(config);
+        CollectSink starved;
+        analyzer.reset();
+        analyzer.analyze(signal.data(), static_cast<int32_t>(signal.size()), starved);
+        arena.reset(SpectrumAnalyzer::arenaBytes(config.fftSize, kind));
+        bool recovered = analyzer.configure(config);
+        CollectSink frames;
+        analyzer.analyze(signal.data(), static_cast<int32_t>(signal.size()), frames);
+        std::printf("%s: configure %s on an empty arena, %zu frames starved, %zu after recovery\n",
+                    kind == kAnalyzerFixedFft ? "fixed" : "fft", failed ? "failed" : "succeeded",
+                    starved.frames.size(), frames.frames.size());
+        pass = pass && failed && starved.frames.empty() && recovered && !frames.frames.empty();
+    }
+    return pass;
+}
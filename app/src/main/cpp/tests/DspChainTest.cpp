@@ -0,0 +1,81 @@
+// parseChainDescriptor on the app's default chain and on malformed records:
+// non-finite values, codes that are not whole numbers and values out of range
+// must be rejected and leave the config untouched.
+
+#include "DspChain.h"
+#include "HostTest.h"
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+namespace {
+
+// The chain MainActivity sends by default (DEFAULT_DSP_CHAIN)
+const float kDefaultChain[] = {
+        kChainGain, 5, 0, 0,
+        kChainAgc, -20, 500, 4000,
+        kChainWindow, 2, 0, 0,
+        kChainFft, 0, 0, 0,
+        kChainBands, 200, 50, 50,
+        kChainSmoothing, 0.7f, 0, 0,
+        kChainNoise, 1, 0.5f, 0.1f,
+};
+
+struct Malformed {
+    const char* what;
+    int record; // Index into kDefaultChain's records
+    int field;
+    float value;
+};
+
+} // namespace
+
+bool testDspChain() {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    const Malformed cases[] = {
+            {"NaN stage", 0, 0, nan},
+            {"infinite stage", 0, 0, inf},
+            {"fractional stage", 0, 0, 1.5f},
+            {"stage beyond int", 0, 0, 3e9f},
+            {"infinite gain", 0, 1, inf},
+            {"NaN gain", 0, 1, nan},
+            {"infinite AGC release", 1, 3, inf},
+            {"fractional window", 2, 1, 1.5f},
+            {"NaN window", 2, 1, nan},
+            {"window beyond int", 2, 1, -3e9f},
+            {"NaN unused parameter", 2, 3, nan},
+            {"fractional FFT size", 3, 1, 2048.5f},
+            {"FFT size beyond int", 3, 1, 1e10f},
+            {"infinite cap", 4, 3, inf},
+            {"NaN smoothing", 5, 1, nan},
+            {"NaN spectral floor", 6, 3, nan},
+    };
+    const int length = static_cast<int>(sizeof(kDefaultChain) / sizeof(kDefaultChain[0]));
+
+    bool pass = true;
+    SpectrumAnalyzerConfig config;
+    int fftSize = -1;
+    if (!parseChainDescriptor(kDefaultChain, length, config, &fftSize) || fftSize != 0 || config.window != 2) {
+        std::printf("default chain rejected or misread\n");
+        pass = false;
+    }
+    int rejected = 0;
+    for (const Malformed& test : cases) {
+        std::vector<float> descriptor(kDefaultChain, kDefaultChain + length);
+        descriptor[test.record * kChainRecordFloats + test.field] = test.value;
+        SpectrumAnalyzerConfig parsed;
+        parsed.gain = 1.25f;
+        int size = -1;
+        bool accepted = parseChainDescriptor(descriptor.data(), length, parsed, &size);
+        if (accepted || parsed.gain != 1.25f || size != -1) {
+            std::printf("%s: accepted\n", test.what);
+            pass = false;
+        } else {
+            rejected++;
+        }
+    }
+    std::printf("default chain parsed, %d of %zu malformed descriptors rejected\n", rejected,
+                sizeof(cases) / sizeof(cases[0]));
+    return pass;
+}
@@ -0,0 +1,54 @@
+// Each specialized FFT against kiss_fftr on music-like input and on noise,
+// relative to the largest bin. Both round differently from the exact
+// transform by about 1e-7 of it; a wrong twiddle or stage shows up as 1e-2 or more.
+
+#include "HostTest.h"
+#include "SizedFft.h"
+#include "TestSignals.h"
+#include "kissfft/kiss_fftr.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+bool testFftTolerance() {
+    constexpr float kMaxError = 1e-5f;
+    constexpr float kSampleRate = 48000.0f;
+    bool pass = true;
+    for (int size : {256, 512, 1024, 2048, 4096, 8192}) {
+        SizedFftFunction fft = sizedFft(size);
+        if (!fft) continue;
+        kiss_fftr_cfg cfg = kiss_fftr_alloc(size, 0, nullptr, nullptr);
+        std::vector<float> input(size);
+        std::vector<kiss_fft_cpx> expected(size / 2 + 1);
+        std::vector<kiss_fft_cpx> output(size / 2 + 1);
+        float maxError = 0.0f;
+        for (int signal = 0; signal < 2; signal++) {
+            if (signal == 0) {
+                fillSignal(input.data(), size, kSampleRate);
+            } else {
+                uint32_t seed = 777;
+                for (float& sample : input) {
+                    seed = seed * 1664525u + 1013904223u;
+                    sample = (seed >> 9) / 8388608.0f - 0.5f;
+                }
+            }
+            kiss_fftr(cfg, input.data(), expected.data());
+            fft(input.data(), output.data());
+            float peak = 0.0f;
+            float error = 0.0f;
+            for (int k = 0; k <= size / 2; k++) {
+                peak = std::max(peak, hypotf(expected[k].r, expected[k].i));
+                error = std::max(error, hypotf(output[k].r - expected[k].r, output[k].i - expected[k].i));
+            }
+            maxError = std::max(maxError, error / peak);
+        }
+        kiss_fftr_free(cfg);
+        bool sizePass = maxError <= kMaxError;
+        std::printf("%4d: max error %.1e of peak, limit %.0e%s\n", size, maxError, kMaxError,
+                    sizePass ? "" : " out of tolerance");
+        pass = pass && sizePass;
+    }
+    return pass;
+}
@@ -0,0 +1,75 @@
+// The fixed-point analyzer against the float one on the same 16-bit PCM, with
+// the app's default chain: music at levels from full scale down to -50 dB,
+// with gaps of silence. Each band output's largest difference is taken
+// relative to that output's range over the run, since near-silent hops have
+// no meaningful relative error; the onset flux is compared the same way.
+
+#include "FixedPoint.h"
+#include "HostTest.h"
+#include "SpectrumAnalyzer.h"
+#include "TestSignals.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+bool testFixedTolerance() {
+    constexpr float kMaxError = 0.05f;
+    SpectrumAnalyzerConfig config;
+    config.window = kWindowBlackmanHarris;
+    config.fftSize = SpectrumAnalyzer::fftSizeForSampleRate(config.sampleRate);
+    SpectrumAnalyzer floatAnalyzer(config);
+    SpectrumAnalyzer fixedAnalyzer(config, nullptr, kAnalyzerFixedFft);
+
+    const int hops = 1200;
+    std::vector<float> signal(static_cast<size_t>(hops) * config.hopSize);
+    fillSignal(signal.data(), static_cast<int>(signal.size()), config.sampleRate);
+    for (size_t i = 0; i < signal.size(); i++) {
+        int hop = static_cast<int>(i / config.hopSize);
+        float levelDb = -50.0f * (hop % 400) / 400.0f; // A slow fade, repeated
+        signal[i] *= hop % 100 < 5 ? 0.0f : 2.5f * powf(10.0f, levelDb / 20.0f);
+    }
+    std::vector<int16_t> pcm16(signal.size());
+    floatToPcm16(pcm16.data(), signal.data(), static_cast<int>(signal.size()));
+    pcm16ToFloat(signal.data(), pcm16.data(), static_cast<int>(signal.size())); // Both see the same samples
+
+    CollectSink floatFrames;
+    CollectSink fixedFrames;
+    floatAnalyzer.analyze(signal.data(), static_cast<int32_t>(signal.size()), floatFrames);
+    fixedAnalyzer.analyze(pcm16.data(), static_cast<int32_t>(pcm16.size()), fixedFrames);
+
+    // Per output: fingers, low average, high peak, leg energy, flux
+    constexpr int kOutputs = BandFrame::kFingerCount + 4;
+    auto outputs = [](const SpectrumFrame& frame, float* values) {
+        for (int i = 0; i < BandFrame::kFingerCount; i++) values[i] = frame.bands.fingers[i];
+        values[BandFrame::kFingerCount] = frame.bands.lowFreqAvg;
+        values[BandFrame::kFingerCount + 1] = frame.bands.highFreqPeak;
+        values[BandFrame::kFingerCount + 2] = frame.bands.legEnergy;
+        values[BandFrame::kFingerCount + 3] = frame.onsetStrength;
+    };
+    float range[kOutputs] = {};
+    float worst[kOutputs] = {};
+    const size_t count = std::min(floatFrames.frames.size(), fixedFrames.frames.size());
+    for (size_t f = 0; f < count; f++) {
+        float values[kOutputs];
+        outputs(floatFrames.frames[f], values);
+        for (int k = 0; k < kOutputs; k++) range[k] = std::max(range[k], fabsf(values[k]));
+    }
+    for (size_t f = 0; f < count; f++) {
+        float expected[kOutputs];
+        float values[kOutputs];
+        outputs(floatFrames.frames[f], expected);
+        outputs(fixedFrames.frames[f], values);
+        for (int k = 0; k < kOutputs; k++) {
+            worst[k] = std::max(worst[k], fabsf(values[k] - expected[k]) / std::max(range[k], 1e-20f));
+        }
+    }
+    float bands = *std::max_element(worst, worst + kOutputs - 1);
+    float flux = worst[kOutputs - 1];
+    bool pass = count == floatFrames.frames.size() && count == fixedFrames.frames.size() && count > 0 &&
+                bands <= kMaxError && flux <= kMaxError;
+    std::printf("%zu hops at %d points, bands %.1e, flux %.1e of range, limit %.0e\n", count, config.fftSize, bands,
+                flux, kMaxError);
+    return pass;
+}
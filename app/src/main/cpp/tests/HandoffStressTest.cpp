@@ -0,0 +1,90 @@
+// The triple buffer between the analysing thread and the poller, with both
+// sides flat out on their own threads. The producer stamps a rising sequence
+// number into every value of each frame it publishes; the consumer checks that
+// every frame it takes is whole, stays unchanged while it holds it, and is
+// newer than the one before. Both yield so the consumer also gets to run on a
+// single core, and the test keeps going until it has read kMinReads frames.
+
+#include "HostTest.h"
+#include "TripleBuffer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <thread>
+
+namespace {
+
+// The size of the engine's spectrum frame, so a copy spans many cache lines
+struct StressFrame {
+    float low[22];
+    float high[1024];
+    int64_t sequence;
+};
+
+// A frame mixing two publishes shows up as a mismatch anywhere in it
+void stampFrame(StressFrame& frame, int64_t sequence) {
+    const float stamp = static_cast<float>(sequence & 0xffffff); // Exact in a float
+    std::fill(std::begin(frame.low), std::end(frame.low), stamp);
+    std::fill(std::begin(frame.high), std::end(frame.high), stamp);
+    frame.sequence = sequence;
+}
+
+bool frameConsistent(const StressFrame& frame) {
+    const float stamp = static_cast<float>(frame.sequence & 0xffffff);
+    auto matches = [stamp](float value) { return value == stamp; };
+    return std::all_of(std::begin(frame.low), std::end(frame.low), matches) &&
+           std::all_of(std::begin(frame.high), std::end(frame.high), matches);
+}
+
+} // namespace
+
+bool testHandoffStress() {
+    constexpr long kMinReads = 20000;
+    constexpr int kPublishesPerRound = 64;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+
+    static TripleBuffer<StressFrame> triple;
+    StressFrame initial;
+    stampFrame(initial, 0);
+    triple.reset(initial);
+
+    std::atomic<bool> done(false);
+    std::atomic<long> reads(0);
+    long torn = 0;
+    long stale = 0; // Not newer than the frame before: re-delivered or out of order
+    std::thread consumer([&]() {
+        int64_t last = 0;
+        while (!done.load(std::memory_order_acquire)) {
+            if (!triple.consume()) {
+                std::this_thread::yield();
+                continue;
+            }
+            const StressFrame& frame = triple.front();
+            const int64_t taken = frame.sequence;
+            std::this_thread::yield(); // Hold the frame while the producer runs, like a slow reader
+            if (!frameConsistent(frame) || frame.sequence != taken) torn++;
+            if (taken <= last) stale++;
+            last = std::max(last, taken);
+            reads.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    int64_t sequence = 0;
+    while (reads.load(std::memory_order_relaxed) < kMinReads && std::chrono::steady_clock::now() < deadline) {
+        for (int i = 0; i < kPublishesPerRound; i++) {
+            stampFrame(triple.back(), ++sequence);
+            triple.publish();
+        }
+        std::this_thread::yield();
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+
+    const long read = reads.load(std::memory_order_relaxed);
+    std::printf("%lld published, %ld read (at least %ld), %ld torn, %ld stale\n", static_cast<long long>(sequence), read,
+                kMinReads, torn, stale);
+    return torn == 0 && stale == 0 && read >= kMinReads;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// Host tests for the native code, run by carbuddy-tests. Each one prints what
+// it measured and returns false if it failed. CMakeLists.txt registers every
+// test with CTest, which runs it in its own carbuddy-tests process.
+bool testHandoffStress();
+bool testBeatTracking();
+bool testArenaFailure();
+bool testDspChain();
+bool testKernelTolerance();
+bool testFixedTolerance();
+bool testFftTolerance();
@@ -0,0 +1,141 @@
+// The legacy magnitude loop (tools/MagnitudeReference.h) and every kernel
+// build this CPU runs, side by side over hops of changing level, each with
+// its own noise floor and flux history. Reports each build's largest
+// difference from the legacy loop in ulp and relative terms; then the same for the STFT unroll and the band sums. The
+// plain C++ build is bit-identical. The vectorized ones differ in the sums
+// (flux, bands: summation order), on ARMv7 (no exact vector sqrt) and
+// wherever the compiler fuses a multiply-add differently, most visibly where
+// the noise subtraction cancels.
+
+#include "HostTest.h"
+#include "MagnitudeReference.h"
+#include "SpectrumKernels.h"
+#include "TestSignals.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Distance in representable floats; 0 for identical values
+int64_t ulpDistance(float a, float b) {
+    int32_t ia;
+    int32_t ib;
+    std::memcpy(&ia, &a, sizeof(ia));
+    std::memcpy(&ib, &b, sizeof(ib));
+    if ((ia < 0) != (ib < 0)) return std::llabs(static_cast<int64_t>(ia & 0x7fffffff)) + (ib & 0x7fffffff);
+    return std::llabs(static_cast<int64_t>(ia) - ib);
+}
+
+// Largest difference of one kernel build from the loops it replaced
+struct KernelError {
+    int64_t magnitudeUlp = 0;
+    float magnitude = 0.0f; // Relative, magnitudes and peak
+    float flux = 0.0f;
+    int64_t frameUlp = 0;   // scaleFrame, which has no reason to differ at all
+    float band = 0.0f;      // dotProduct, relative
+};
+
+} // namespace
+
+bool testKernelTolerance() {
+    constexpr float kMaxError = 1e-5f; // Relative, for the magnitudes, the flux and the bands
+    SpectrumAnalyzerConfig config;
+    const MagnitudeLayout layout = defaultMagnitudeLayout(config.sampleRate);
+    const int fftSize = 2 * layout.bins;
+    const float hopSeconds = config.hopSize / config.sampleRate;
+    const SpectrumKernelTable* kernels[8];
+    const int variantCount = spectrumKernelVariants(kernels, 8);
+
+    struct Path {
+        DspArena arena;
+        NoiseFloor noise;
+        std::vector<float> previous;
+        MagnitudeOutput output;
+    };
+    std::vector<Path> paths(variantCount + 1); // paths[0] is the legacy loop
+    for (Path& path : paths) {
+        path.arena.reset(NoiseFloor::arenaBytes(layout.bins));
+        path.noise.configure(layout.bins, hopSeconds, path.arena);
+        path.previous.assign(layout.bins, 0.0f);
+    }
+    std::vector<KernelError> errors(variantCount);
+    std::vector<float> music(fftSize + 4096);
+    fillSignal(music.data(), static_cast<int>(music.size()), config.sampleRate);
+    const int kHops = 400; // Long enough for the noise floor to roll its sub-windows several times
+    for (int hop = 0; hop < kHops; hop++) {
+        float amplitude = hop % 50 < 5 ? 0.0f : 5.0f * (1.0f + 0.5f * sinf(hop * 0.1f)); // Gaps of silence
+        const float* samples = music.data() + (hop * 257) % 4096;
+        std::vector<kiss_fft_cpx> spectrum = windowedSpectrum(samples, fftSize, amplitude);
+        legacyMagnitudes(spectrum.data(), layout, &paths[0].noise, paths[0].previous.data(), paths[0].output);
+        const MagnitudeOutput& reference = paths[0].output;
+        for (int k = 0; k < variantCount; k++) {
+            Path& path = paths[k + 1];
+            kernelMagnitudes(kernels[k]->magnitude, spectrum.data(), layout, &path.noise, path.previous.data(),
+                             path.output);
+            KernelError& error = errors[k];
+            auto compare = [&](float value, float expected) {
+                error.magnitudeUlp = std::max(error.magnitudeUlp, ulpDistance(value, expected));
+                float scale = std::max(fabsf(expected), 1e-20f);
+                error.magnitude = std::max(error.magnitude, fabsf(value - expected) / scale);
+            };
+            compare(path.output.peak, reference.peak);
+            for (int i = 0; i < layout.lowEnd - layout.lowStart; i++) compare(path.output.low[i], reference.low[i]);
+            for (int i = 0; i < std::min(SpectrumFrame::kHighFreqBins, layout.bins - layout.highStart); i++) {
+                compare(path.output.high[i], reference.high[i]);
+            }
+            error.flux = std::max(error.flux, fabsf(path.output.flux - reference.flux) / std::max(reference.flux, 1e-20f));
+        }
+    }
+
+    // The STFT unroll at every split the circular history can have, and band
+    // sums of every length up to a wide top band, at odd alignments
+    std::vector<float> signal(fftSize + 64);
+    fillSignal(signal.data(), static_cast<int>(signal.size()), config.sampleRate);
+    std::vector<float> window(fftSize);
+    for (int i = 0; i < fftSize; i++) window[i] = 0.5f - 0.5f * cosf(6.2831853f * i / fftSize);
+    std::vector<float> expected(fftSize);
+    std::vector<float> frame(fftSize);
+    const float gain = 3.7f;
+    for (int k = 0; k < variantCount; k++) {
+        KernelError& error = errors[k];
+        for (int split = 0; split < 64; split += 7) {
+            for (int windowed = 0; windowed < 2; windowed++) {
+                const float* w = windowed ? window.data() + split : nullptr;
+                const int count = fftSize - split;
+                for (int i = 0; i < count; i++) expected[i] = signal[split + i] * gain * (w ? w[i] : 1.0f);
+                kernels[k]->scaleFrame(frame.data(), signal.data() + split, count, gain, w);
+                for (int i = 0; i < count; i++) {
+                    error.frameUlp = std::max(error.frameUlp, ulpDistance(frame[i], expected[i]));
+                }
+            }
+        }
+        for (int count = 1; count <= 160; count++) {
+            const int offset = count % 5;
+            std::vector<float> magnitudes(count);
+            float sum = 0.0f; // BandReducer's original loop
+            for (int i = 0; i < count; i++) {
+                magnitudes[i] = fabsf(signal[offset + i]);
+                sum += window[offset + i] * magnitudes[i];
+            }
+            float value = kernels[k]->dotProduct(window.data() + offset, magnitudes.data(), count);
+            error.band = std::max(error.band, fabsf(value - sum) / std::max(sum, 1e-20f));
+        }
+    }
+
+    bool pass = variantCount > 0;
+    for (int k = 0; k < variantCount; k++) {
+        const KernelError& error = errors[k];
+        bool variantPass = error.magnitude <= kMaxError && error.flux <= kMaxError && error.frameUlp == 0 &&
+                           error.band <= kMaxError;
+        std::printf("%-6s magnitudes %ld ulp (%.1e), flux %.1e, frame %ld ulp, bands %.1e, limit %.0e%s\n",
+                    kernels[k]->variant, static_cast<long>(error.magnitudeUlp), error.magnitude, error.flux,
+                    static_cast<long>(error.frameUlp), error.band, kMaxError, variantPass ? "" : " out of tolerance");
+        pass = pass && variantPass;
+    }
+    return pass;
+}
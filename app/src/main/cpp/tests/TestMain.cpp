@@ -0,0 +1,56 @@
+// Runs the host tests named on the command line, or all of them, and exits
+// with status 1 if any failed:
+//
+//   carbuddy-tests [<test>...]
+
+#include "HostTest.h"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+struct HostTest {
+    const char* name;
+    bool (*run)();
+};
+
+const HostTest kTests[] = {
+    {"handoff_stress", testHandoffStress},
+    {"beat_tracking", testBeatTracking},
+    {"arena_failure", testArenaFailure},
+    {"dsp_chain", testDspChain},
+    {"kernel_tolerance", testKernelTolerance},
+    {"fixed_tolerance", testFixedTolerance},
+    {"fft_tolerance", testFftTolerance},
+};
+
+bool runTest(const HostTest& test) {
+    bool pass = test.run();
+    std::printf("%s: %s\n", test.name, pass ? "pass" : "FAIL");
+    return pass;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int failures = 0;
+    if (argc == 1) {
+        for (const HostTest& test : kTests) {
+            if (!runTest(test)) failures++;
+        }
+    }
+    for (int i = 1; i < argc; i++) {
+        const HostTest* found = nullptr;
+        for (const HostTest& test : kTests) {
+            if (std::strcmp(test.name, argv[i]) == 0) found = &test;
+        }
+        if (!found) {
+            std::fprintf(stderr, "unknown test %s; tests are:", argv[i]);
+            for (const HostTest& test : kTests) std::fprintf(stderr, " %s", test.name);
+            std::fprintf(stderr, "\n");
+            return 2;
+        }
+        if (!runTest(*found)) failures++;
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+// Inputs and sinks shared by the host tests
+
+#include "BandAnalyzer.h"
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Bass line plus a few partials and a little noise, roughly music-shaped; the
+// same signal carbuddy-bench times the analyzers on
+inline void fillSignal(float* data, int count, float sampleRate) {
+    const float kTwoPi = 6.2831853f;
+    uint32_t seed = 12345;
+    for (int i = 0; i < count; i++) {
+        float t = i / sampleRate;
+        seed = seed * 1664525u + 1013904223u;
+        float noise = ((seed >> 9) / 8388608.0f - 0.5f) * 0.02f;
+        data[i] = 0.3f * sinf(kTwoPi * 55.0f * t) + 0.1f * sinf(kTwoPi * 440.0f * t)
+                  + 0.05f * sinf(kTwoPi * 2500.0f * t) + noise;
+    }
+}
+
+// Keeps a copy of every frame an analyzer publishes
+class CollectSink final : public FrameSink {
+public:
+    SpectrumFrame& beginFrame() override { return frame; }
+    void publishFrame() override { frames.push_back(frame); }
+
+    std::vector<SpectrumFrame> frames;
+
+private:
+    SpectrumFrame frame = {};
+};
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+# Writes drum_loop_100bpm.wav and its beat annotations, drum_loop_100bpm.txt:
+# 12 s of kick on every beat, snare on 2 and 4, closed hi-hat on the eighths
+# and a bass line, at 16 kHz 16-bit mono to keep the checked-in file small.
+# Regenerating gives the same bytes.
+
+import math
+import random
+import struct
+import wave
+
+RATE = 16000
+BPM = 100.0
+SECONDS = 12.0
+FIRST_BEAT = 0.25
+
+period = 60.0 / BPM
+samples = [0.0] * int(SECONDS * RATE)
+rng = random.Random(100)
+
+
+def add(start, length, voice):
+    first = int(start * RATE)
+    for i in range(min(int(length * RATE), len(samples) - first)):
+        samples[first + i] += voice(i / RATE)
+
+
+def kick(t):
+    return 0.5 * math.exp(-t / 0.05) * math.sin(2 * math.pi * (50.0 * t + 60.0 * 0.03 * (1 - math.exp(-t / 0.03))))
+
+
+def snare(t):
+    return math.exp(-t / 0.06) * (0.15 * math.sin(2 * math.pi * 190.0 * t) + 0.2 * (rng.random() - 0.5))
+
+
+def hat(t):
+    return 0.06 * math.exp(-t / 0.01) * (rng.random() - 0.5)
+
+
+beats = []
+t = FIRST_BEAT
+n = 0
+while t < SECONDS:
+    beats.append(t)
+    add(t, 0.3, kick)
+    if n % 2 == 1:
+        add(t, 0.2, snare)
+    add(t, 0.05, hat)
+    add(t + period / 2, 0.05, hat)
+    # Bass note per bar, a fifth up on the third beat
+    root = [55.0, 49.0, 65.4, 58.3][(n // 4) % 4] * (1.5 if n % 4 == 2 else 1.0)
+    add(t, period * 0.9, lambda s, f=root: 0.12 * min(1.0, s / 0.01) * math.exp(-s / 0.4) * math.sin(2 * math.pi * f * s))
+    t += period
+    n += 1
+
+with wave.open('drum_loop_100bpm.wav', 'wb') as out:
+    out.setnchannels(1)
+    out.setsampwidth(2)
+    out.setframerate(RATE)
+    out.writeframes(b''.join(struct.pack('<h', max(-32767, min(32767, int(round(s * 32767))))) for s in samples))
+
+with open('drum_loop_100bpm.txt', 'w') as out:
+    out.writelines('%.6f\n' % beat for beat in beats)
@@ -0,0 +1,72 @@
+#pragma once
+
+// Beat tracking accuracy for the host tools: scoring tracked beats against
+// annotated ones, and a synthetic click track to score against.
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+struct BeatScore {
+    size_t tracked;  // Beats after the lock-in period
+    size_t expected; // Annotations after the lock-in period
+    double precision;
+    double recall;
+    double fMeasure;
+    double meanOffsetMs; // Tracked minus annotated, over the hits
+};
+
+// A tracked beat within 70 ms of an unused annotation is a hit; the first 5 s
+// are skipped while the tempo locks. Both lists in seconds, ascending.
+inline BeatScore scoreBeats(const std::vector<double>& detected, const std::vector<double>& reference) {
+    const double kToleranceSeconds = 0.07;
+    const double kSkipSeconds = 5.0;
+    std::vector<double> found, expected;
+    for (double t : detected) if (t >= kSkipSeconds) found.push_back(t);
+    for (double t : reference) if (t >= kSkipSeconds) expected.push_back(t);
+    size_t hits = 0;
+    size_t next = 0;
+    double errorSum = 0.0;
+    for (double t : found) {
+        while (next < expected.size() && expected[next] < t - kToleranceSeconds) next++;
+        if (next < expected.size() && std::fabs(expected[next] - t) <= kToleranceSeconds) {
+            errorSum += t - expected[next];
+            hits++;
+            next++;
+        }
+    }
+    BeatScore score;
+    score.tracked = found.size();
+    score.expected = expected.size();
+    score.precision = found.empty() ? 0.0 : static_cast<double>(hits) / found.size();
+    score.recall = expected.empty() ? 0.0 : static_cast<double>(hits) / expected.size();
+    score.fMeasure = score.precision + score.recall > 0.0
+                     ? 2.0 * score.precision * score.recall / (score.precision + score.recall) : 0.0;
+    score.meanOffsetMs = hits ? 1000.0 * errorSum / hits : 0.0;
+    return score;
+}
+
+// seconds of a kick-and-click metronome at bpm over a bass drone and a little
+// noise, roughly a drum track at moderate level; *clicks gets the beat times
+inline std::vector<float> synthesizeClickTrack(float sampleRate, float bpm, float seconds, std::vector<double>* clicks) {
+    const float kTwoPi = 6.2831853f;
+    std::vector<float> samples(static_cast<size_t>(seconds * sampleRate));
+    const double period = 60.0 / bpm;
+    for (double t = 0.5; t < seconds; t += period) clicks->push_back(t);
+    uint32_t seed = 4242;
+    for (size_t i = 0; i < samples.size(); i++) {
+        float t = i / sampleRate;
+        seed = seed * 1664525u + 1013904223u;
+        samples[i] = 0.05f * sinf(kTwoPi * 55.0f * t) + 0.005f * ((seed >> 9) / 8388608.0f - 0.5f);
+    }
+    for (double click : *clicks) {
+        size_t start = static_cast<size_t>(click * sampleRate);
+        size_t length = static_cast<size_t>(0.15f * sampleRate);
+        for (size_t i = 0; i < length && start + i < samples.size(); i++) {
+            float t = i / sampleRate;
+            samples[start + i] += 0.4f * expf(-t / 0.04f) * sinf(kTwoPi * 70.0f * t)     // Kick
+                                  + 0.2f * expf(-t / 0.005f) * sinf(kTwoPi * 3000.0f * t); // Click
+        }
+    }
+    return samples;
+}
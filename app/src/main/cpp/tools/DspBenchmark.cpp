@@ -0,0 +1,589 @@
+// Host microbenchmarks for the DSP core. Each stage is timed in isolation and
+// reported as ns/op, ns per audio frame and "x realtime" (audio time covered by
+// one op divided by the time the op takes), so regressions show up across releases.
+// --kernels runs the stages on one build of the spectrum kernels instead of
+// the one the CPU would get; the magnitude_* stages always time every build.
+//
+//   carbuddy-bench [--filter <substring>] [--min-ms <ms>] [--hop <samples>] [--kernels <variant>] [--csv]
+
+#include "AnalysisPipeline.h"
+#include "BeatTracker.h"
+#include "EngineRegistry.h"
+#include "EnvelopeAnalyzer.h"
+#include "FixedFft.h"
+#include "FixedPoint.h"
+#include "MagnitudeReference.h"
+#include "NoiseFloor.h"
+#include "SizedFft.h"
+#include "SpectrumAnalyzer.h"
+#include "SpectrumKernels.h"
+#include "StftAccumulator.h"
+#include "TripleBuffer.h"
+#include <pthread.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct BenchOptions {
+    std::string filter;
+    double minMs = 200.0;
+    int hopSize = 512;
+    float sampleRate = 48000.0f;
+    std::string kernels; // Empty: whatever selectSpectrumKernels() picks
+    bool csv = false;
+};
+
+BenchOptions options;
+volatile float sink; // Keeps results observable so the optimiser cannot drop the work
+
+void printHeader() {
+    if (options.csv) {
+        std::printf("stage,size,ns_per_op,ns_per_frame,x_realtime\n");
+    } else {
+        std::printf("spectrum kernels: %s\n", spectrumKernels().variant);
+        std::printf("%-28s %6s %14s %12s %12s\n", "stage", "size", "ns/op", "ns/frame", "x realtime");
+    }
+}
+
+// Every build of the spectrum kernels this CPU runs, the plain C++ one last
+std::vector<const SpectrumKernelTable*> kernelVariants() {
+    const SpectrumKernelTable* variants[8];
+    int count = spectrumKernelVariants(variants, 8);
+    return std::vector<const SpectrumKernelTable*>(variants, variants + count);
+}
+
+void report(const char* stage, int size, double nsPerOp, int framesPerOp) {
+    double nsPerFrame = framesPerOp > 0 ? nsPerOp / framesPerOp : 0.0;
+    double realtime = framesPerOp > 0 ? (framesPerOp / options.sampleRate * 1e9) / nsPerOp : 0.0;
+    if (options.csv) {
+        std::printf("%s,%d,%.1f,%.3f,%.1f\n", stage, size, nsPerOp, nsPerFrame, realtime);
+    } else if (framesPerOp > 0) {
+        std::printf("%-28s %6d %14.1f %12.3f %12.1f\n", stage, size, nsPerOp, nsPerFrame, realtime);
+    } else {
+        std::printf("%-28s %6d %14.1f %12s %12s\n", stage, size, nsPerOp, "-", "-");
+    }
+}
+
+bool selected(const char* stage) {
+    return options.filter.empty() || std::strstr(stage, options.filter.c_str()) != nullptr;
+}
+
+// Runs op in growing batches until minMs has elapsed; returns mean ns per call
+template <typename Op>
+double measure(Op&& op) {
+    for (int i = 0; i < 8; i++) op(); // Warm caches and branch predictors
+    using Clock = std::chrono::steady_clock;
+    long iterations = 0;
+    long batch = 1;
+    double elapsedNs = 0.0;
+    while (elapsedNs < options.minMs * 1e6) {
+        auto start = Clock::now();
+        for (long i = 0; i < batch; i++) op();
+        elapsedNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        iterations += batch;
+        batch *= 2;
+    }
+    return elapsedNs / iterations;
+}
+
+void fillSignal(float* data, int count, float sampleRate) {
+    // Bass line plus a few partials and a little noise, roughly music-shaped
+    uint32_t seed = 12345;
+    for (int i = 0; i < count; i++) {
+        float t = i / sampleRate;
+        seed = seed * 1664525u + 1013904223u;
+        float noise = ((seed >> 9) / 8388608.0f - 0.5f) * 0.02f;
+        data[i] = 0.3f * sinf(2.0f * static_cast<float>(M_PI) * 55.0f * t)
+                  + 0.1f * sinf(2.0f * static_cast<float>(M_PI) * 440.0f * t)
+                  + 0.05f * sinf(2.0f * static_cast<float>(M_PI) * 2500.0f * t) + noise;
+    }
+}
+
+const int kFftSizes[] = {256, 512, 1024, 2048, 4096, 8192};
+
+void benchFftAlloc() {
+    if (!selected("kiss_fftr_alloc")) return;
+    for (int size : kFftSizes) {
+        double ns = measure([size]() {
+            kiss_fftr_cfg cfg = kiss_fftr_alloc(size, 0, nullptr, nullptr);
+            sink = cfg ? 1.0f : 0.0f;
+            kiss_fftr_free(cfg);
+        });
+        report("kiss_fftr_alloc", size, ns, 0);
+    }
+}
+
+void benchFftExecute() {
+    if (!selected("kiss_fftr")) return;
+    for (int size : kFftSizes) {
+        kiss_fftr_cfg cfg = kiss_fftr_alloc(size, 0, nullptr, nullptr);
+        std::vector<float> input(size);
+        std::vector<kiss_fft_cpx> output(size / 2 + 1);
+        fillSignal(input.data(), size, options.sampleRate);
+        double ns = measure([&]() {
+            kiss_fftr(cfg, input.data(), output.data());
+            sink = output[1].r;
+        });
+        kiss_fftr_free(cfg);
+        report("kiss_fftr", size, ns, std::min(options.hopSize, size));
+    }
+}
+
+// The specialized FFTs (SizedFft.h) at the sizes that have one, against kiss_fftr above
+void benchSizedFftExecute() {
+    if (!selected("sized_fft")) return;
+    for (int size : kFftSizes) {
+        SizedFftFunction fft = sizedFft(size);
+        if (!fft) continue;
+        std::vector<float> input(size);
+        std::vector<kiss_fft_cpx> output(size / 2 + 1);
+        fillSignal(input.data(), size, options.sampleRate);
+        double ns = measure([&]() {
+            fft(input.data(), output.data());
+            sink = output[1].r;
+        });
+        report("sized_fft", size, ns, std::min(options.hopSize, size));
+    }
+}
+
+// The fixed-point build of the same transform, on the int16 the I16 capture delivers
+void benchFixedFftExecute() {
+    if (!selected("kiss_fftr_q15")) return;
+    for (int size : kFftSizes) {
+        size_t planBytes = 0;
+        fixedFftAlloc(size, nullptr, &planBytes);
+        DspArena arena(planBytes);
+        const FixedFftPlan* plan = fixedFftAlloc(size, arena.carve(planBytes), &planBytes);
+        std::vector<float> signal(size);
+        fillSignal(signal.data(), size, options.sampleRate);
+        std::vector<int16_t> input(size);
+        floatToPcm16(input.data(), signal.data(), size);
+        std::vector<FixedComplex> output(size / 2 + 1);
+        double ns = measure([&]() {
+            fixedFft(plan, input.data(), output.data());
+            sink = output[1].r;
+        });
+        report("kiss_fftr_q15", size, ns, std::min(options.hopSize, size));
+    }
+}
+
+void benchAnalyzerStages() {
+    SpectrumAnalyzerConfig config;
+    config.hopSize = options.hopSize;
+    config.sampleRate = options.sampleRate;
+    SpectrumAnalyzer analyzer(config);
+    std::vector<float> window(config.fftSize);
+    fillSignal(window.data(), config.fftSize, config.sampleRate);
+    for (float& sample : window) sample *= config.gain;
+    analyzer.transform(window.data());
+    SpectrumFrame frame = {};
+    const int hop = analyzer.getHopSize();
+
+    if (selected("processFrequencies")) {
+        double ns = measure([&]() {
+            analyzer.processFrequencies(frame);
+            sink = frame.highFreqMagnitude[10];
+        });
+        report("processFrequencies", config.fftSize, ns, hop);
+    }
+    if (selected("reduceBands")) {
+        analyzer.processFrequencies(frame);
+        double ns = measure([&]() {
+            analyzer.reduceBands(frame);
+            sink = frame.bands.fingers[3];
+        });
+        report("reduceBands", config.fftSize, ns, hop);
+    }
+    if (selected("clamp_copy")) {
+        // The clamp/copy SharedSpectrumBuffer::publish() does into the Java-visible arrays
+        static float lowOut[SpectrumFrame::kLowFreqBins];
+        static float highOut[SpectrumFrame::kHighFreqBins];
+        double ns = measure([&]() {
+            clampCopy(lowOut, frame.lowFreqMagnitude, SpectrumFrame::kLowFreqBins, 0.0f, 1000.0f);
+            clampCopy(highOut, frame.highFreqMagnitude, SpectrumFrame::kHighFreqBins, 0.0f, 1000.0f);
+            sink = lowOut[0] + highOut[7];
+        });
+        report("clamp_copy", SpectrumFrame::kHighFreqBins, ns, hop);
+    }
+    if (selected("shared_publish")) {
+        SharedSpectrumBuffer<SpectrumFrame::kLowFreqBins, SpectrumFrame::kHighFreqBins> shared;
+        double ns = measure([&]() {
+            shared.publish(frame.bands, frame.lowFreqMagnitude, frame.highFreqMagnitude, 0.0f, 1000.0f);
+        });
+        report("shared_publish", SpectrumFrame::kHighFreqBins, ns, hop);
+    }
+}
+
+// A spectrum of the bench signal, windowed like the app's chain and scaled by amplitude
+std::vector<kiss_fft_cpx> benchSpectrum(int fftSize, int offset, float amplitude) {
+    std::vector<float> signal(fftSize + offset);
+    fillSignal(signal.data(), static_cast<int>(signal.size()), options.sampleRate);
+    return windowedSpectrum(signal.data() + offset, fftSize, amplitude);
+}
+
+// Post-FFT pass per hop: the old per-bin loop against every build of
+// magnitudeKernel, with and without the noise floor
+void benchMagnitudeKernels() {
+    const MagnitudeLayout layout = defaultMagnitudeLayout(options.sampleRate);
+    const int fftSize = 2 * layout.bins;
+    std::vector<kiss_fft_cpx> spectrum = benchSpectrum(fftSize, 0, 5.0f);
+    std::vector<const SpectrumKernelTable*> kernels = kernelVariants();
+    kernels.insert(kernels.begin(), nullptr); // The legacy loop
+    for (int denoise = 0; denoise < 2; denoise++) {
+        const char* suffix = denoise ? "_noise" : "";
+        for (const SpectrumKernelTable* variant : kernels) {
+            std::string stage = std::string("magnitude_") + (variant ? variant->variant : "legacy") + suffix;
+            if (!selected(stage.c_str())) continue;
+            DspArena arena(NoiseFloor::arenaBytes(layout.bins));
+            NoiseFloor noise;
+            noise.configure(layout.bins, options.hopSize / options.sampleRate, arena);
+            std::vector<float> previous(layout.bins, 0.0f);
+            MagnitudeOutput output;
+            NoiseFloor* noiseFloor = denoise ? &noise : nullptr;
+            double ns = measure([&]() {
+                if (!variant) {
+                    legacyMagnitudes(spectrum.data(), layout, noiseFloor, previous.data(), output);
+                } else {
+                    kernelMagnitudes(variant->magnitude, spectrum.data(), layout, noiseFloor, previous.data(), output);
+                }
+                sink = output.peak + output.flux;
+            });
+            report(stage.c_str(), fftSize, ns, options.hopSize);
+        }
+    }
+}
+
+// One hop through the STFT front end: copy in, then unroll with the gain, and
+// the window fused into that pass or as the separate pass it used to be
+void benchStftFrame() {
+    const int fftSize = SpectrumAnalyzerConfig().fftSize;
+    const int hop = options.hopSize;
+    DspArena arena(3 * DspArena::alignUp(fftSize * sizeof(float)));
+    float* history = arena.carve<float>(fftSize);
+    float* frameBuffer = arena.carve<float>(fftSize);
+    float* window = arena.carve<float>(fftSize);
+    for (int i = 0; i < fftSize; i++) window[i] = 0.5f - 0.5f * cosf(2.0f * static_cast<float>(M_PI) * i / fftSize);
+    std::vector<float> signal(fftSize * 4);
+    fillSignal(signal.data(), static_cast<int>(signal.size()), options.sampleRate);
+    const float gain = 5.0f;
+
+    struct Variant {
+        const char* stage;
+        const float* fusedWindow;
+        bool separatePass;
+    };
+    const Variant variants[] = {
+        {"stft_frame_rect", nullptr, false},
+        {"stft_frame_window_fused", window, false},
+        {"stft_frame_window_separate", nullptr, true},
+    };
+    for (const Variant& variant : variants) {
+        if (!selected(variant.stage)) continue;
+        StftAccumulator stft;
+        stft.configure(fftSize, hop, history, frameBuffer);
+        size_t offset = 0;
+        double ns = measure([&]() {
+            stft.push(signal.data() + offset, hop, gain, variant.fusedWindow, [&](float* frame) {
+                if (variant.separatePass) {
+                    for (int i = 0; i < fftSize; i++) frame[i] *= window[i];
+                }
+                sink = frame[fftSize / 2];
+            });
+            offset = (offset + hop) % (signal.size() - hop);
+        });
+        report(variant.stage, fftSize, ns, hop);
+    }
+}
+
+// Whole analyzers through the BandAnalyzer interface, one hop of PCM per op:
+// the cost of choosing the envelope analyzer over the FFT on a slow phone
+class DiscardSink final : public FrameSink {
+public:
+    SpectrumFrame& beginFrame() override { return frame; }
+    void publishFrame() override { sink = frame.bands.fingers[3]; }
+
+private:
+    SpectrumFrame frame = {};
+};
+
+// analyze_fixed is fed int16, as from an I16 stream
+void benchAnalyzers() {
+    SpectrumAnalyzerConfig config;
+    config.hopSize = options.hopSize;
+    config.sampleRate = options.sampleRate;
+    SpectrumAnalyzer fftAnalyzer(config);
+    EnvelopeAnalyzer envelopeAnalyzer(config);
+    SpectrumAnalyzer fixedAnalyzer(config, nullptr, kAnalyzerFixedFft);
+    setSizedFftEnabled(false);
+    SpectrumAnalyzer kissAnalyzer(config); // The same on kissfft, for the specialized FFT's end-to-end gain
+    setSizedFftEnabled(true);
+    std::vector<float> signal(config.fftSize * 8);
+    fillSignal(signal.data(), static_cast<int>(signal.size()), config.sampleRate);
+    std::vector<int16_t> pcm16(signal.size());
+    floatToPcm16(pcm16.data(), signal.data(), static_cast<int>(signal.size()));
+    const int hop = fftAnalyzer.getHopSize();
+
+    BandAnalyzer* analyzers[] = {&fftAnalyzer, &kissAnalyzer, &envelopeAnalyzer, &fixedAnalyzer};
+    const char* stages[] = {"analyze_fft", "analyze_fft_kissfft", "analyze_envelope", "analyze_fixed"};
+    for (int i = 0; i < 4; i++) {
+        if (!selected(stages[i])) continue;
+        DiscardSink discard;
+        size_t offset = 0;
+        const bool int16Input = analyzers[i]->getKind() == kAnalyzerFixedFft;
+        double ns = measure([&]() {
+            if (int16Input) {
+                analyzers[i]->analyze(pcm16.data() + offset, hop, discard);
+            } else {
+                analyzers[i]->analyze(signal.data() + offset, hop, discard);
+            }
+            offset = (offset + hop) % (signal.size() - hop);
+        });
+        report(stages[i], config.fftSize, ns, hop);
+    }
+}
+
+// Onset picking, the periodic tempo autocorrelation (amortized over its
+// interval) and the phase update, per hop; compare against kiss_fftr
+void benchBeatTracker() {
+    if (!selected("beat_tracker")) return;
+    const float hopSeconds = options.hopSize / options.sampleRate;
+    const int beatHops = static_cast<int>(0.5f / hopSeconds); // 120 BPM
+    std::vector<float> flux(BeatTracker::kHistoryHops * 4);
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < flux.size(); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        flux[i] = (i % beatHops == 0 ? 1.0f : 0.0f) + (seed >> 9) / 8388608.0f * 0.1f;
+    }
+    BeatTracker tracker;
+    BeatEvent events[BeatTracker::kMaxEventsPerHop];
+    float phase = 0.0f;
+    size_t index = 0;
+    int64_t timestampNs = 0;
+    const int64_t hopNs = static_cast<int64_t>(hopSeconds * 1e9f);
+    double ns = measure([&]() {
+        int count = tracker.process(flux[index], hopSeconds, timestampNs, events, &phase);
+        sink = phase + count;
+        index = (index + 1) % flux.size();
+        timestampNs += hopNs;
+    });
+    report("beat_tracker", BeatTracker::kHistoryHops, ns, options.hopSize);
+}
+
+// Minimum-statistics tracking and subtraction over every bin of one hop,
+// including the amortized sub-window roll; processFrequencies includes it
+void benchNoiseFloor() {
+    if (!selected("noise_floor")) return;
+    SpectrumAnalyzerConfig config;
+    const int bins = config.fftSize / 2;
+    DspArena arena(NoiseFloor::arenaBytes(bins));
+    NoiseFloor noiseFloor;
+    noiseFloor.configure(bins, options.hopSize / options.sampleRate, arena);
+    std::vector<float> magnitudes(bins);
+    fillSignal(magnitudes.data(), bins, options.sampleRate);
+    for (float& magnitude : magnitudes) magnitude = fabsf(magnitude);
+    double ns = measure([&]() {
+        float total = 0.0f;
+        for (int i = 0; i < bins; i++) {
+            float noise = noiseFloor.track(i, magnitudes[i]);
+            total += NoiseFloor::subtract(magnitudes[i], noise, 2.0f, 0.1f);
+        }
+        noiseFloor.endHop();
+        sink = total;
+    });
+    report("noise_floor", bins, ns, options.hopSize);
+}
+
+void benchPipeline() {
+    if (!selected("pipeline_callback")) return;
+    const int bursts[] = {96, 192, 480};
+    for (int burst : bursts) {
+        SpectrumAnalyzerConfig config;
+        config.hopSize = options.hopSize;
+        config.sampleRate = options.sampleRate;
+        AnalysisPipeline pipeline(config);
+        std::vector<float> signal(burst * 64);
+        fillSignal(signal.data(), static_cast<int>(signal.size()), config.sampleRate);
+        size_t offset = 0;
+        double ns = measure([&]() {
+            pipeline.onAudio(signal.data() + offset, burst);
+            offset = (offset + burst) % signal.size();
+            pipeline.consume();
+        });
+        report("pipeline_callback", burst, ns, burst);
+    }
+}
+
+// The worker at real-time pace for two seconds, one burst every burst period:
+// mean and worst time from a callback's write to the end of its analysis
+// (workerLagLastNs sampled before each write), which is mostly how long the
+// worker takes to wake
+void benchWorkerLag() {
+    if (!selected("pipeline_worker_lag")) return;
+    constexpr int kBurst = 192;
+    SpectrumAnalyzerConfig config;
+    config.hopSize = options.hopSize;
+    config.sampleRate = options.sampleRate;
+    AnalysisPipeline pipeline(config);
+    std::vector<float> signal(kBurst * 64);
+    fillSignal(signal.data(), static_cast<int>(signal.size()), config.sampleRate);
+    pipeline.startWorker(0, 0);
+    const auto period = std::chrono::nanoseconds(static_cast<int64_t>(kBurst / config.sampleRate * 1e9));
+    const int bursts = static_cast<int>(2.0f * config.sampleRate / kBurst);
+    auto next = std::chrono::steady_clock::now();
+    double lagSum = 0.0;
+    int lagCount = 0;
+    for (int i = 0; i < bursts; i++) {
+        int64_t stats[AnalysisPipeline::kStatCount];
+        pipeline.getStats(stats, AnalysisPipeline::kStatCount);
+        if (i > 0) {
+            lagSum += stats[2];
+            lagCount++;
+        }
+        pipeline.onAudio(signal.data() + (i % 64) * kBurst, kBurst);
+        next += period;
+        std::this_thread::sleep_until(next);
+    }
+    int64_t stats[AnalysisPipeline::kStatCount];
+    pipeline.getStats(stats, AnalysisPipeline::kStatCount);
+    pipeline.stopWorker();
+    report("pipeline_worker_lag", kBurst, lagCount ? lagSum / lagCount : 0.0, 0);
+    report("pipeline_worker_lag_max", kBurst, static_cast<double>(stats[3]), 0);
+}
+
+// Replays the producer/consumer hand-off with the producer at audio pacing and
+// the reader copying flat out, the worst case for a lock the reader holds while
+// it copies. Counts how often the producer (the audio callback) found the
+// reader in the way and had to wait, and the longest publish.
+template <typename Publish, typename Poll>
+void runHandoff(const char* stage, Publish&& publish, Poll&& poll) {
+    const int kBursts = 2000;
+    const auto burstPeriod = std::chrono::microseconds(500);
+    std::atomic<bool> done(false);
+    std::thread reader([&]() {
+        while (!done.load(std::memory_order_acquire)) {
+            poll();
+        }
+    });
+
+    long blocked = 0;
+    double maxNs = 0.0;
+    for (int i = 0; i < kBursts; i++) {
+        auto start = std::chrono::steady_clock::now();
+        if (!publish()) blocked++;
+        maxNs = std::max(maxNs, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+        std::this_thread::sleep_until(start + burstPeriod);
+    }
+    done.store(true, std::memory_order_release);
+    reader.join();
+
+    if (options.csv) {
+        std::printf("%s,%d,%.1f,%ld,0\n", stage, kBursts, maxNs, blocked);
+    } else {
+        std::printf("%-28s %6d bursts: %ld would have blocked, max publish %.1f ns\n", stage, kBursts, blocked, maxNs);
+    }
+}
+
+void benchHandoff() {
+    if (!selected("handoff")) return;
+    static SpectrumFrame source = {};
+
+    // The pre-triple-buffer scheme: the callback copied under audioMutex while the
+    // reader held the same mutex around its copy (and its timed wait)
+    {
+        pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+        pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+        static SpectrumFrame shared = {};
+        static SpectrumFrame readerCopy = {};
+        runHandoff("handoff_mutex", [&]() {
+            bool acquired = pthread_mutex_trylock(&mutex) == 0;
+            if (!acquired) pthread_mutex_lock(&mutex);
+            shared = source;
+            pthread_cond_signal(&cond);
+            pthread_mutex_unlock(&mutex);
+            return acquired;
+        }, [&]() {
+            pthread_mutex_lock(&mutex);
+            readerCopy = shared;
+            pthread_mutex_unlock(&mutex);
+        });
+    }
+
+    {
+        static TripleBuffer<SpectrumFrame> triple;
+        static SpectrumFrame readerCopy = {};
+        triple.reset(source);
+        runHandoff("handoff_triple_buffer", [&]() {
+            triple.back() = source;
+            triple.publish();
+            return true; // Wait-free by construction
+        }, [&]() {
+            if (triple.consume()) readerCopy = triple.front();
+        });
+    }
+}
+
+// Cost every JNI call pays to resolve its engine handle
+void benchRegistry() {
+    if (!selected("registry_acquire")) return;
+    static EngineRegistry<SpectrumFrame> registry;
+    static SpectrumFrame engine = {};
+    int64_t handle = registry.add(&engine);
+    double ns = measure([&]() {
+        EngineRegistry<SpectrumFrame>::Lease lease = registry.acquire(handle);
+        sink = lease->bands.legEnergy;
+    });
+    registry.remove(handle);
+    report("registry_acquire", 1, ns, 0);
+}
+
+void parseArgs(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--min-ms" && i + 1 < argc) {
+            options.minMs = std::atof(argv[++i]);
+        } else if (arg == "--hop" && i + 1 < argc) {
+            options.hopSize = std::atoi(argv[++i]);
+        } else if (arg == "--kernels" && i + 1 < argc) {
+            options.kernels = argv[++i];
+        } else if (arg == "--csv") {
+            options.csv = true;
+        } else {
+            std::fprintf(stderr, "usage: %s [--filter <substring>] [--min-ms <ms>] [--hop <samples>] [--kernels <variant>] [--csv]\n", argv[0]);
+            std::exit(2);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    parseArgs(argc, argv);
+    if (!options.kernels.empty() && !selectSpectrumKernels(options.kernels.c_str())) return 2;
+    printHeader();
+    benchFftAlloc();
+    benchFftExecute();
+    benchSizedFftExecute();
+    benchFixedFftExecute();
+    benchAnalyzerStages();
+    benchStftFrame();
+    benchMagnitudeKernels();
+    benchAnalyzers();
+    benchBeatTracker();
+    benchNoiseFloor();
+    benchPipeline();
+    benchWorkerLag();
+    benchHandoff();
+    benchRegistry();
+    return 0;
+}
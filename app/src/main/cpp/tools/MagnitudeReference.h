@@ -0,0 +1,139 @@
+#pragma once
+
+// The post-FFT magnitude pass as it was before the spectrum kernels, and the
+// same pass through a kernel, for carbuddy-bench to time and the
+// kernel_tolerance test to compare.
+
+#include "NoiseFloor.h"
+#include "SpectrumAnalyzer.h"
+#include "SpectrumKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Bin ranges and parameters of the default chain, as SpectrumAnalyzer::buildBinMap() derives them
+struct MagnitudeLayout {
+    int bins; // fftSize / 2; bins 1 to bins - 1 are analysed
+    int lowStart;
+    int lowEnd;
+    int highStart;
+    int roadEnd;
+    float scale;
+    float lowSensitivity;
+    float highSensitivity;
+    float cap;
+    float oversubtraction;
+    float roadOversubtraction;
+    float spectralFloor;
+};
+
+inline MagnitudeLayout defaultMagnitudeLayout(float sampleRate) {
+    SpectrumAnalyzerConfig config;
+    const int nyquistBin = config.fftSize / 2;
+    const float binHz = sampleRate / config.fftSize;
+    auto toBin = [&](float hz) { return std::max(1, std::min(static_cast<int>(lroundf(hz / binHz)), nyquistBin)); };
+    MagnitudeLayout layout;
+    layout.bins = nyquistBin;
+    layout.lowStart = toBin(config.lowBandMinHz);
+    layout.lowEnd = std::min(toBin(config.lowBandMaxHz), layout.lowStart + SpectrumFrame::kLowFreqBins);
+    layout.highStart = toBin(config.highBandMinHz);
+    layout.roadEnd = toBin(config.roadNoiseMaxHz);
+    layout.scale = 1.0f / config.fftSize;
+    layout.lowSensitivity = config.lowSensitivity;
+    layout.highSensitivity = config.highSensitivity;
+    layout.cap = config.magnitudeCap;
+    layout.oversubtraction = config.noiseOversubtraction;
+    layout.roadOversubtraction = config.noiseOversubtraction + 0.5f * config.noiseSpeedOversubtraction;
+    layout.spectralFloor = config.noiseSpectralFloor;
+    return layout;
+}
+
+// Magnitudes from one spectrum into a frame, plus the flux and high peak
+struct MagnitudeOutput {
+    float low[SpectrumFrame::kLowFreqBins];
+    float high[SpectrumFrame::kHighFreqBins];
+    float flux;
+    float peak;
+};
+
+// processFrequencies() as it was before magnitudeKernel(): one pass with
+// per-bin branches. The reference the kernels are timed and checked against.
+inline void legacyMagnitudes(const kiss_fft_cpx* spectrum, const MagnitudeLayout& layout, NoiseFloor* noise, float* previous,
+                             MagnitudeOutput& output) {
+    float flux = 0.0f;
+    float highFreqMax = 0.0f;
+    for (int i = 1; i < layout.bins; i++) {
+        float real = spectrum[i].r;
+        float imag = spectrum[i].i;
+        float magnitude = sqrtf(real * real + imag * imag) * layout.scale;
+        if (noise) {
+            float floor = noise->track(i, magnitude);
+            magnitude = NoiseFloor::subtract(magnitude, floor, i < layout.roadEnd ? layout.roadOversubtraction : layout.oversubtraction,
+                                             layout.spectralFloor);
+        }
+        flux += std::max(0.0f, magnitude - previous[i]);
+        previous[i] = magnitude;
+        if (i >= layout.lowStart && i < layout.lowEnd) {
+            magnitude *= layout.lowSensitivity;
+        } else if (i >= layout.highStart && (i - layout.highStart) < SpectrumFrame::kHighFreqBins) {
+            magnitude *= layout.highSensitivity;
+        } else {
+            magnitude = 0.0f;
+        }
+        magnitude = std::min(magnitude, layout.cap);
+        if (i >= layout.lowStart && i < layout.lowEnd) {
+            output.low[i - layout.lowStart] = magnitude;
+        } else if (i >= layout.highStart && (i - layout.highStart) < SpectrumFrame::kHighFreqBins) {
+            output.high[i - layout.highStart] = magnitude;
+            highFreqMax = std::max(highFreqMax, magnitude);
+        }
+    }
+    if (noise) noise->endHop();
+    output.flux = flux;
+    output.peak = highFreqMax;
+}
+
+using MagnitudeKernel = float (*)(const kiss_fft_cpx*, const MagnitudeSegment&, const MagnitudeParams&, float*);
+
+// The same pass through a kernel, over the segments SpectrumAnalyzer builds
+inline void kernelMagnitudes(MagnitudeKernel kernel, const kiss_fft_cpx* spectrum, const MagnitudeLayout& layout,
+                             NoiseFloor* noise, float* previous, MagnitudeOutput& output) {
+    const int highEnd = std::min(layout.highStart + SpectrumFrame::kHighFreqBins, layout.bins);
+    int bounds[] = {1, layout.lowStart, layout.lowEnd, layout.highStart, highEnd, layout.roadEnd, layout.bins};
+    std::sort(bounds, bounds + 7);
+    NoiseFloor::Lanes lanes;
+    if (noise) lanes = noise->getLanes();
+    MagnitudeParams params = {layout.scale, layout.cap, previous, noise ? &lanes : nullptr, layout.spectralFloor, nullptr};
+    output.flux = 0.0f;
+    output.peak = 0.0f;
+    for (int b = 0; b + 1 < 7; b++) {
+        MagnitudeSegment segment = {bounds[b], bounds[b + 1], nullptr, 0.0f,
+                                    bounds[b] < layout.roadEnd ? layout.roadOversubtraction : layout.oversubtraction};
+        bool high = false;
+        if (segment.begin >= layout.lowStart && segment.begin < layout.lowEnd) {
+            segment.out = output.low + (segment.begin - layout.lowStart);
+            segment.sensitivity = layout.lowSensitivity;
+        } else if (segment.begin >= layout.highStart && segment.begin < highEnd) {
+            segment.out = output.high + (segment.begin - layout.highStart);
+            segment.sensitivity = layout.highSensitivity;
+            high = true;
+        }
+        float peak = kernel(spectrum, segment, params, &output.flux);
+        if (high) output.peak = std::max(output.peak, peak);
+    }
+    if (noise) noise->endHop();
+}
+
+// fftSize samples, Hann windowed like the app's chain and scaled by amplitude, through kiss_fftr
+inline std::vector<kiss_fft_cpx> windowedSpectrum(const float* samples, int fftSize, float amplitude) {
+    std::vector<float> frame(fftSize);
+    for (int i = 0; i < fftSize; i++) {
+        float hann = 0.5f - 0.5f * cosf(6.2831853f * i / fftSize);
+        frame[i] = samples[i] * amplitude * hann;
+    }
+    kiss_fftr_cfg cfg = kiss_fftr_alloc(fftSize, 0, nullptr, nullptr);
+    std::vector<kiss_fft_cpx> spectrum(fftSize / 2 + 1);
+    kiss_fftr(cfg, frame.data(), spectrum.data());
+    kiss_fftr_free(cfg);
+    return spectrum;
+}
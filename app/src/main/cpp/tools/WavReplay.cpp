@@ -0,0 +1,477 @@
+// Streams a WAV or raw PCM recording through the same analyzer code the capture
+// callback runs, in callback-sized chunks and as fast as the host allows.
+// Writes one BandFrame per hop as CSV or binary and reports throughput.
+//
+//   carbuddy-replay <input> [--raw s16|f32 --rate <hz> --channels <n>]
+//                   [--burst <frames>] [--analyzer fft|envelope|fixed] [--fft <n>]
+//                   [--hop <n>] [--gain <x>] [--low-sens <x>] [--high-sens <x>]
+//                   [--cap <x>] [--chain <descriptor>] [--csv <path>] [--bin <path>]
+//                   [--beats <path>] [--reference <path>] [--speed <m/s>]
+//                   [--min-f-measure <f>] [--expect-bpm <bpm>]
+//                   [--window rect|hann|blackman-harris|flat-top]
+//                   [--kernels neon|vfp|avx2|sse2|scalar] [--kissfft]
+//
+// --chain takes the same descriptor the app sends through setDspChain, as
+// comma-separated floats (see DspChain.h), e.g. "1,5,0,0,2,1,0,0,4,200,50,50".
+//
+// The binary output is a 24-byte header ("CBBF", version, floats per frame,
+// sample rate, hop size, fft size as little-endian uint32) followed by packed
+// BandFrame structs.
+//
+// --beats writes the BeatTracker's onsets and beats as CSV. --reference scores
+// the tracked beats against annotated beat times (one time in seconds per line,
+// first column, e.g. a click track's clicks): a beat within 70 ms of an unused
+// annotation is a hit, the first 5 s are skipped while the tempo locks, and
+// precision, recall and F-measure are printed. --min-f-measure and
+// --expect-bpm turn that into a test: the exit status is 1 if the F-measure
+// is below the minimum or the final tempo is more than 2 BPM off.
+//
+// --speed replays the recording as if driven at that speed, which scales the
+// noise floor subtraction below roadNoiseMaxHz (kChainNoise in the chain).
+// --analyzer fixed runs the fixed-point SpectrumAnalyzer; the samples are
+// rounded to 16 bits on the way in, which a 16-bit mono recording survives exactly.
+// --window selects the STFT window as a kChainWindow record would; give it
+// after --chain, which replaces the whole chain.
+// --kernels runs on that build of the spectrum kernels instead of the one the
+// CPU would get, so outputs can be diffed between builds. --kissfft does the
+// same for the FFT: kissfft at every size instead of the specialized ones.
+
+#include "BeatScore.h"
+#include "BeatTracker.h"
+#include "DspChain.h"
+#include "EnvelopeAnalyzer.h"
+#include "SizedFft.h"
+#include "SpectrumAnalyzer.h"
+#include "SpectrumKernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum SampleFormat { kFormatS16, kFormatS24, kFormatS32, kFormatF32 };
+
+struct PcmSource {
+    FILE* file = nullptr;
+    SampleFormat format = kFormatS16;
+    int channels = 1;
+    int sampleRate = 48000;
+    uint64_t dataBytesLeft = UINT64_MAX; // Raw files run to EOF
+
+    int bytesPerSample() const {
+        switch (format) {
+            case kFormatS16: return 2;
+            case kFormatS24: return 3;
+            default: return 4;
+        }
+    }
+};
+
+struct ReplayOptions {
+    std::string inputPath;
+    std::string csvPath;
+    std::string binPath;
+    std::string beatsPath;
+    std::string referencePath;
+    double minFMeasure = -1.0; // Not checked unless set
+    float expectedBpm = -1.0f;
+    bool raw = false;
+    bool fftSizeSet = false; // Otherwise chosen from the sample rate, as the app does
+    int burstFrames = 192;
+    float speed = -1.0f;     // m/s for the road-noise subtraction, as GPS would report; unknown by default
+    AnalyzerKind analyzer = kAnalyzerFft;
+    SpectrumAnalyzerConfig config;
+};
+
+uint32_t readLe32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+uint16_t readLe16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+void writeLe32(FILE* file, uint32_t value) {
+    uint8_t bytes[4] = {static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8),
+                        static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24)};
+    fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+// Walks the RIFF chunks up to "data"; supports PCM 16/24/32-bit, float32 and WAVE_FORMAT_EXTENSIBLE
+bool openWav(PcmSource& source) {
+    uint8_t header[12];
+    if (fread(header, 1, 12, source.file) != 12 || memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+        fprintf(stderr, "Not a RIFF/WAVE file\n");
+        return false;
+    }
+    bool haveFormat = false;
+    uint8_t chunk[8];
+    while (fread(chunk, 1, 8, source.file) == 8) {
+        uint32_t chunkSize = readLe32(chunk + 4);
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            std::vector<uint8_t> fmt(chunkSize);
+            if (chunkSize < 16 || fread(fmt.data(), 1, chunkSize, source.file) != chunkSize) return false;
+            uint16_t formatTag = readLe16(&fmt[0]);
+            if (formatTag == 0xFFFE && chunkSize >= 26) formatTag = readLe16(&fmt[24]); // SubFormat GUID prefix
+            source.channels = readLe16(&fmt[2]);
+            source.sampleRate = static_cast<int>(readLe32(&fmt[4]));
+            uint16_t bits = readLe16(&fmt[14]);
+            if (formatTag == 3 && bits == 32) {
+                source.format = kFormatF32;
+            } else if (formatTag == 1 && bits == 16) {
+                source.format = kFormatS16;
+            } else if (formatTag == 1 && bits == 24) {
+                source.format = kFormatS24;
+            } else if (formatTag == 1 && bits == 32) {
+                source.format = kFormatS32;
+            } else {
+                fprintf(stderr, "Unsupported WAV format tag %u with %u bits\n", formatTag, bits);
+                return false;
+            }
+            if (chunkSize & 1) fseek(source.file, 1, SEEK_CUR);
+            haveFormat = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat) {
+                fprintf(stderr, "WAV data chunk before fmt chunk\n");
+                return false;
+            }
+            source.dataBytesLeft = chunkSize;
+            return source.channels > 0;
+        } else {
+            fseek(source.file, chunkSize + (chunkSize & 1), SEEK_CUR);
+        }
+    }
+    fprintf(stderr, "No WAV data chunk\n");
+    return false;
+}
+
+// Reads up to maxFrames interleaved frames and downmixes them to mono floats
+int readFrames(PcmSource& source, std::vector<uint8_t>& scratch, float* output, int maxFrames) {
+    const int frameBytes = source.bytesPerSample() * source.channels;
+    uint64_t wanted = static_cast<uint64_t>(maxFrames) * frameBytes;
+    if (wanted > source.dataBytesLeft) wanted = source.dataBytesLeft - source.dataBytesLeft % frameBytes;
+    scratch.resize(wanted);
+    size_t got = fread(scratch.data(), 1, wanted, source.file);
+    int frames = static_cast<int>(got / frameBytes);
+    if (source.dataBytesLeft != UINT64_MAX) source.dataBytesLeft -= got;
+
+    const float channelScale = 1.0f / source.channels;
+    const uint8_t* p = scratch.data();
+    for (int i = 0; i < frames; i++) {
+        float sum = 0.0f;
+        for (int c = 0; c < source.channels; c++) {
+            switch (source.format) {
+                case kFormatS16:
+                    sum += static_cast<int16_t>(readLe16(p)) / 32768.0f;
+                    break;
+                case kFormatS24:
+                    sum += static_cast<int32_t>((p[0] << 8) | (p[1] << 16) | (static_cast<uint32_t>(p[2]) << 24)) / 2147483648.0f;
+                    break;
+                case kFormatS32:
+                    sum += static_cast<int32_t>(readLe32(p)) / 2147483648.0f;
+                    break;
+                case kFormatF32: {
+                    uint32_t bits = readLe32(p);
+                    float value;
+                    memcpy(&value, &bits, sizeof(value));
+                    sum += value;
+                    break;
+                }
+            }
+            p += source.bytesPerSample();
+        }
+        output[i] = sum * channelScale;
+    }
+    return frames;
+}
+
+// A whole decimal number above zero, nothing else
+bool parsePositive(const char* text, int* value) {
+    char* end;
+    long parsed = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || parsed <= 0 || parsed > INT32_MAX) return false;
+    *value = static_cast<int>(parsed);
+    return true;
+}
+
+[[noreturn]] void usage(const char* program) {
+    fprintf(stderr,
+            "usage: %s <input> [--raw s16|f32 --rate <hz> --channels <n>] [--burst <frames>]\n"
+            "       [--analyzer fft|envelope|fixed] [--fft <n>] [--hop <n>] [--gain <x>] [--low-sens <x>] [--high-sens <x>] [--cap <x>]\n"
+            "       [--chain <descriptor>] [--csv <path>] [--bin <path>] [--beats <path>] [--reference <path>]\n"
+            "       [--min-f-measure <f>] [--expect-bpm <bpm>]\n"
+            "       [--speed <m/s>] [--window rect|hann|blackman-harris|flat-top] [--kernels <variant>] [--kissfft]\n", program);
+    exit(2);
+}
+
+bool parseArgs(int argc, char** argv, ReplayOptions& options, PcmSource& source) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg[0] != '-' && options.inputPath.empty()) {
+            options.inputPath = arg;
+        } else if (!hasValue) {
+            usage(argv[0]);
+        } else if (arg == "--raw") {
+            std::string format = argv[++i];
+            if (format != "s16" && format != "f32") usage(argv[0]);
+            options.raw = true;
+            source.format = format == "s16" ? kFormatS16 : kFormatF32;
+        } else if (arg == "--rate") {
+            source.sampleRate = atoi(argv[++i]);
+        } else if (arg == "--channels") {
+            source.channels = atoi(argv[++i]);
+        } else if (arg == "--burst") {
+            options.burstFrames = atoi(argv[++i]);
+        } else if (arg == "--analyzer") {
+            std::string kind = argv[++i];
+            if (kind == "fft") {
+                options.analyzer = kAnalyzerFft;
+            } else if (kind == "envelope") {
+                options.analyzer = kAnalyzerEnvelope;
+            } else if (kind == "fixed") {
+                options.analyzer = kAnalyzerFixedFft;
+            } else {
+                usage(argv[0]);
+            }
+        } else if (arg == "--fft") {
+            // The sizes a chain descriptor accepts
+            if (!parsePositive(argv[++i], &options.config.fftSize) ||
+                !SpectrumAnalyzer::isValidFftSize(options.config.fftSize)) {
+                fprintf(stderr, "--fft must be a power of two from %d to %d\n", SpectrumAnalyzer::kMinFftSize,
+                        SpectrumAnalyzer::kMaxFftSize);
+                usage(argv[0]);
+            }
+            options.fftSizeSet = true;
+        } else if (arg == "--hop") {
+            if (!parsePositive(argv[++i], &options.config.hopSize)) {
+                fprintf(stderr, "--hop must be a positive number of samples\n");
+                usage(argv[0]);
+            }
+        } else if (arg == "--gain") {
+            options.config.gain = static_cast<float>(atof(argv[++i]));
+        } else if (arg == "--low-sens") {
+            options.config.lowSensitivity = static_cast<float>(atof(argv[++i]));
+        } else if (arg == "--high-sens") {
+            options.config.highSensitivity = static_cast<float>(atof(argv[++i]));
+        } else if (arg == "--cap") {
+            options.config.magnitudeCap = static_cast<float>(atof(argv[++i]));
+        } else if (arg == "--chain") {
+            std::vector<float> descriptor;
+            for (const char* p = argv[++i]; *p;) {
+                char* end;
+                descriptor.push_back(strtof(p, &end));
+                if (end == p) usage(argv[0]);
+                p = *end == ',' ? end + 1 : end;
+            }
+            int fftSize = 0;
+            if (!parseChainDescriptor(descriptor.data(), static_cast<int>(descriptor.size()), options.config, &fftSize)) {
+                usage(argv[0]);
+            }
+            if (fftSize != 0) {
+                options.config.fftSize = fftSize;
+                options.fftSizeSet = true;
+            }
+        } else if (arg == "--csv") {
+            options.csvPath = argv[++i];
+        } else if (arg == "--bin") {
+            options.binPath = argv[++i];
+        } else if (arg == "--beats") {
+            options.beatsPath = argv[++i];
+        } else if (arg == "--reference") {
+            options.referencePath = argv[++i];
+        } else if (arg == "--min-f-measure") {
+            options.minFMeasure = atof(argv[++i]);
+        } else if (arg == "--expect-bpm") {
+            options.expectedBpm = static_cast<float>(atof(argv[++i]));
+        } else if (arg == "--window") {
+            static const char* const kWindows[kWindowTypeCount] = {"rect", "hann", "blackman-harris", "flat-top"};
+            const char* name = argv[++i];
+            int type = 0;
+            while (type < kWindowTypeCount && strcmp(name, kWindows[type]) != 0) type++;
+            if (type == kWindowTypeCount) usage(argv[0]);
+            options.config.window = type;
+            options.config.stages |= kStageWindow;
+        } else if (arg == "--speed") {
+            options.speed = static_cast<float>(atof(argv[++i]));
+        } else if (arg == "--kernels") {
+            if (!selectSpectrumKernels(argv[++i])) usage(argv[0]);
+        } else if (arg == "--kissfft") {
+            setSizedFftEnabled(false);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    return !options.inputPath.empty() && options.burstFrames > 0 && source.channels > 0 && source.sampleRate > 0;
+}
+
+void writeCsvHeader(FILE* csv) {
+    fprintf(csv, "frame,time_s");
+    for (int i = 0; i < BandFrame::kFingerCount; i++) fprintf(csv, ",finger%d", i);
+    fprintf(csv, ",leg,low_avg,high_peak,smoothed_low_avg,smoothed_high_peak,beat_phase\n");
+}
+
+void writeCsvRow(FILE* csv, long frameIndex, double timeSeconds, const BandFrame& bands) {
+    fprintf(csv, "%ld,%.4f", frameIndex, timeSeconds);
+    for (float finger : bands.fingers) fprintf(csv, ",%.6g", finger);
+    fprintf(csv, ",%.6g,%.6g,%.6g,%.6g,%.6g,%.4f\n", bands.legEnergy, bands.lowFreqAvg, bands.highFreqPeak,
+            bands.smoothedLowFreqAvg, bands.smoothedHighFreqPeak, bands.beatPhase);
+}
+
+// First number on each line; blank lines and lines starting with '#' are skipped
+bool readReferenceBeats(const std::string& path, std::vector<double>& times) {
+    FILE* file = fopen(path.c_str(), "r");
+    if (!file) return false;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char* end;
+        double time = strtod(line, &end);
+        if (end != line && line[0] != '#') times.push_back(time);
+    }
+    fclose(file);
+    std::sort(times.begin(), times.end());
+    return true;
+}
+
+// Runs the beat tracker over every frame the analyzer publishes, as the pipeline does, and writes it
+class ReplaySink final : public FrameSink {
+public:
+    ReplaySink(FILE* csv, FILE* bin, FILE* beats, int sampleRate, const BandAnalyzer& analyzer)
+            : csv(csv), bin(bin), beats(beats), sampleRate(sampleRate), analyzer(analyzer) {}
+
+    SpectrumFrame& beginFrame() override { return frame; }
+
+    void publishFrame() override {
+        // Stamped with the end of the burst that completed the hop, as the app would see it
+        double timeSeconds = static_cast<double>(burstEndSample) / sampleRate;
+        BeatEvent events[BeatTracker::kMaxEventsPerHop];
+        int eventCount = beatTracker.process(frame.onsetStrength, static_cast<float>(analyzer.getHopSize()) / sampleRate,
+                                             static_cast<int64_t>(timeSeconds * 1e9), events, &frame.bands.beatPhase);
+        for (int i = 0; i < eventCount; i++) {
+            double eventSeconds = events[i].timestampNs / 1e9;
+            if (events[i].type == kBeatEventBeat) beatTimes.push_back(eventSeconds);
+            if (beats) {
+                fprintf(beats, "%.4f,%s,%.2f,%.3f\n", eventSeconds, events[i].type == kBeatEventBeat ? "beat" : "onset",
+                        events[i].bpm, events[i].strength);
+            }
+        }
+        if (csv) writeCsvRow(csv, frameIndex, timeSeconds, frame.bands);
+        if (bin) fwrite(&frame.bands, sizeof(BandFrame), 1, bin);
+        frameIndex++;
+    }
+
+    uint64_t burstEndSample = 0;
+    long frameIndex = 0;
+    std::vector<double> beatTimes;
+    BeatTracker beatTracker;
+
+private:
+    FILE* csv;
+    FILE* bin;
+    FILE* beats;
+    int sampleRate;
+    const BandAnalyzer& analyzer;
+    SpectrumFrame frame = {};
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ReplayOptions options;
+    PcmSource source;
+    if (!parseArgs(argc, argv, options, source)) usage(argv[0]);
+
+    source.file = fopen(options.inputPath.c_str(), "rb");
+    if (!source.file) {
+        fprintf(stderr, "Cannot open %s\n", options.inputPath.c_str());
+        return 1;
+    }
+    if (!options.raw && !openWav(source)) {
+        fclose(source.file);
+        return 1;
+    }
+
+    options.config.sampleRate = static_cast<float>(source.sampleRate);
+    if (!options.fftSizeSet) options.config.fftSize = SpectrumAnalyzer::fftSizeForSampleRate(options.config.sampleRate);
+    SpectrumAnalyzer fftAnalyzer(options.config, nullptr,
+                                 options.analyzer == kAnalyzerFixedFft ? kAnalyzerFixedFft : kAnalyzerFft);
+    EnvelopeAnalyzer envelopeAnalyzer(options.config);
+    BandAnalyzer& analyzer = options.analyzer == kAnalyzerEnvelope ? static_cast<BandAnalyzer&>(envelopeAnalyzer) : fftAnalyzer;
+    analyzer.setVehicleSpeed(options.speed);
+
+    FILE* csv = options.csvPath.empty() ? nullptr : fopen(options.csvPath.c_str(), "w");
+    FILE* bin = options.binPath.empty() ? nullptr : fopen(options.binPath.c_str(), "wb");
+    FILE* beats = options.beatsPath.empty() ? nullptr : fopen(options.beatsPath.c_str(), "w");
+    if ((!options.csvPath.empty() && !csv) || (!options.binPath.empty() && !bin) || (!options.beatsPath.empty() && !beats)) {
+        fprintf(stderr, "Cannot open output file\n");
+        return 1;
+    }
+    std::vector<double> referenceBeats;
+    if (!options.referencePath.empty() && !readReferenceBeats(options.referencePath, referenceBeats)) {
+        fprintf(stderr, "Cannot read reference beats %s\n", options.referencePath.c_str());
+        return 1;
+    }
+    if (csv) writeCsvHeader(csv);
+    if (beats) fprintf(beats, "time_s,event,bpm,strength\n");
+    if (bin) {
+        fwrite("CBBF", 1, 4, bin);
+        writeLe32(bin, 1);
+        writeLe32(bin, sizeof(BandFrame) / sizeof(float));
+        writeLe32(bin, static_cast<uint32_t>(source.sampleRate));
+        writeLe32(bin, static_cast<uint32_t>(analyzer.getHopSize()));
+        writeLe32(bin, static_cast<uint32_t>(options.config.fftSize));
+    }
+
+    std::vector<uint8_t> scratch;
+    std::vector<float> burst(options.burstFrames);
+    ReplaySink output(csv, bin, beats, source.sampleRate, analyzer);
+    uint64_t samplesRead = 0;
+    double analysisNs = 0.0;
+    auto wallStart = std::chrono::steady_clock::now();
+
+    int count;
+    while ((count = readFrames(source, scratch, burst.data(), options.burstFrames)) > 0) {
+        auto start = std::chrono::steady_clock::now();
+        output.burstEndSample = samplesRead + count;
+        analyzer.analyze(burst.data(), count, output);
+        analysisNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        samplesRead += count;
+    }
+    double wallNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - wallStart).count();
+
+    fclose(source.file);
+    if (csv) fclose(csv);
+    if (bin) fclose(bin);
+    if (beats) fclose(beats);
+
+    double audioSeconds = static_cast<double>(samplesRead) / source.sampleRate;
+    fprintf(stderr, "%s: %.1f s of audio at %d Hz, %d ch, %ld band frames (%s, fft %d, hop %d, burst %d, %s kernels, %s FFT)\n",
+            options.inputPath.c_str(), audioSeconds, source.sampleRate, source.channels, output.frameIndex,
+            options.analyzer == kAnalyzerEnvelope ? "envelope" : options.analyzer == kAnalyzerFixedFft ? "fixed" : "fft",
+            options.config.fftSize, analyzer.getHopSize(), options.burstFrames, spectrumKernels().variant,
+            fftAnalyzer.usesSizedFft() ? "specialized" : "kissfft");
+    fprintf(stderr, "analysis %.1f ms (%.0fx realtime, %.1f ns/frame), wall %.1f ms including I/O\n",
+            analysisNs / 1e6, analysisNs > 0 ? audioSeconds * 1e9 / analysisNs : 0.0,
+            samplesRead > 0 ? analysisNs / samplesRead : 0.0, wallNs / 1e6);
+    fprintf(stderr, "tempo %.1f BPM, confidence %.2f, %zu beats\n",
+            output.beatTracker.getBpm(), output.beatTracker.getConfidence(), output.beatTimes.size());
+    bool pass = true;
+    if (!options.referencePath.empty()) {
+        BeatScore score = scoreBeats(output.beatTimes, referenceBeats);
+        fprintf(stderr, "beats: %zu tracked, %zu annotated after 5 s; precision %.3f, recall %.3f, F %.3f, mean offset %+.1f ms\n",
+                score.tracked, score.expected, score.precision, score.recall, score.fMeasure, score.meanOffsetMs);
+        if (options.minFMeasure >= 0.0 && score.fMeasure < options.minFMeasure) {
+            fprintf(stderr, "FAIL: F-measure %.3f below %.3f\n", score.fMeasure, options.minFMeasure);
+            pass = false;
+        }
+    } else if (options.minFMeasure >= 0.0) {
+        fprintf(stderr, "--min-f-measure needs --reference\n");
+        pass = false;
+    }
+    if (options.expectedBpm > 0.0f && fabsf(output.beatTracker.getBpm() - options.expectedBpm) > 2.0f) {
+        fprintf(stderr, "FAIL: tempo %.1f BPM, expected %.1f\n", output.beatTracker.getBpm(), options.expectedBpm);
+        pass = false;
+    }
+    return pass ? 0 : 1;
+}
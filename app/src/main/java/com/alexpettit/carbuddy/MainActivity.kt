@@ -56,6 +56,10 @@ import okhttp3.MediaType.Companion.toMediaType
 import okhttp3.RequestBody.Companion.toRequestBody
 import java.io.File
 import java.io.FileInputStream
+import java.lang.invoke.VarHandle
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.nio.FloatBuffer
 import java.text.SimpleDateFormat
 import java.util.*
 import java.util.concurrent.TimeUnit
@@ -84,12 +88,16 @@ class MainActivity : ComponentActivity(), SensorEventListener {
     private var latitude by mutableStateOf(0.0)
     private var longitude by mutableStateOf(0.0)
 
-    private var lowFreqData = FloatArray(22) { 0f }
-    private var highFreqData = FloatArray(1024) { 0f }
+    private val bandFrame = FloatArray(BAND_FRAME_FLOATS) // Native BandFrame, see BandReducer.h
     private var lowFreqAvg by mutableStateOf(0f)
     private var highFreqPeak by mutableStateOf(0f)
     private var smoothedLowFreqAvg by mutableStateOf(0f)
     private var smoothedHighFreqPeak by mutableStateOf(0f)
+    private var beatPhase by mutableStateOf(-1f) // -1 until the native beat tracker locks
+    private var beatCount by mutableStateOf(0)   // Alternates the stomping leg
+    private var beatBpm = 0f
+    private val beatTimes = LongArray(BEAT_EVENT_BATCH)
+    private val beatValues = FloatArray(BEAT_EVENT_BATCH * 3)
 
     private var bumpEffect by mutableStateOf(0f)
     private var turnEffect by mutableStateOf(0f)
@@ -102,7 +110,19 @@ class MainActivity : ComponentActivity(), SensorEventListener {
     private lateinit var locationCallback: LocationCallback
     private lateinit var audioScope: CoroutineScope
 
-    private var audioEnginePtr: Long = 0L
+    private var audioEngineHandle: Long = 0L
+    private var audioJob: Job? = null
+    private var startAnalyzer = ANALYZER_FFT // The analyzer this run's hop timings belong to
+
+    // Zero-copy spectrum published by the native engine (see SharedSpectrumBuffer.h)
+    private var spectrumBuffer: ByteBuffer? = null
+    private var bandView: FloatBuffer? = null
+    @Volatile private var fenceWord = 0 // Only for loadFence() before API 33
+    private var lastSpectrumSequence = -1
+    private var sharedEventsOffset = 0 // Byte offset of eventsWritten
+    private var sharedEventCapacity = 0
+    private var lastEventsWritten = 0
+    private var sharedBeatEvents = 0 // Events the last readSharedBands() copied into beatTimes / beatValues
 
     private val isCustomizationUnlocked = true
     private var emoji80 by mutableStateOf("😈")
@@ -138,14 +158,96 @@ class MainActivity : ComponentActivity(), SensorEventListener {
 
     companion object {
         private const val TAG = "CarBuddy"
+        private const val SPECTRUM_HOP_SIZE = 512 // Samples between FFTs, ~94 spectra/s at 48 kHz
+
+        // BandFrame layout: 10 finger bands followed by these values
+        private const val BAND_FRAME_FLOATS = 16
+        private const val BAND_LEG = 10
+        private const val BAND_LOW_AVG = 11
+        private const val BAND_HIGH_PEAK = 12
+        private const val BAND_SMOOTHED_LOW_AVG = 13
+        private const val BAND_SMOOTHED_HIGH_PEAK = 14
+        private const val BAND_BEAT_PHASE = 15
+        private const val SHARED_BAND_OFFSET = 16 // Byte offset of the BandFrame in the shared buffer
+        private const val SHARED_SPECTRUM_OFFSET = 80 // lowFreq, highFreq, then the beat events
+        private const val SHARED_EVENT_BYTES = 24 // One native BeatEvent
+
+        // getEngineStats layout: [p50, p99, max, count] per histogram, then counters
+        private const val ENGINE_STAT_COUNT = 20
+        private const val HIST_CALLBACK_NS = 0
+        private const val HIST_HOP_ANALYSIS_NS = 4
+        private const val HIST_BURST_FRAMES = 8
+        private const val HIST_FRAME_AGE_NS = 12
+        private const val STAT_NO_FRESH_POLLS = 16
+        private const val STAT_STALE_READS = 17
+        private const val STAT_XRUNS = 18
+        private const val STAT_TIME_TO_FIRST_SPECTRUM_NS = 19
+
+        // Native AnalyzerKind, see BandAnalyzer.h
+        private const val ANALYZER_FFT = 0
+        private const val ANALYZER_ENVELOPE = 1
+        private const val ANALYZER_FIXED_FFT = 2
+        private const val PREF_ANALYZER = "audio_analyzer"
+        // Hop analysis p99 above this (about a quarter of the 512-sample hop) means
+        // the analyzer is too heavy for this phone. The float FFT falls back to the
+        // fixed-point one on 32-bit devices, anything else to the envelope analyzer.
+        private const val HOP_ANALYSIS_BUDGET_NS = 2_500_000L
+        private const val PIPELINE_STAT_COUNT = 9
+
+        // Native DSP chain descriptor, records of {stage, p0, p1, p2} (see DspChain.h).
+        // The default: AGC to -20 dBFS starting from the old fixed gain of 5 (0.5 s
+        // attack, 4 s release), Blackman-Harris window, FFT sized from the sample rate,
+        // sensitivities 200/50 with a cap of 50, smoothing 0.7, noise floor subtracted
+        // once, 1.5 times below 500 Hz at highway speed, keeping at least 10% of each bin.
+        // A comma-separated override in PREF_DSP_CHAIN lets a field test try another chain.
+        private const val PREF_DSP_CHAIN = "dsp_chain"
+        private val DEFAULT_DSP_CHAIN = floatArrayOf(
+            1f, 5f, 0f, 0f,          // Gain, the AGC's starting point
+            6f, -20f, 500f, 4000f,   // AGC: target dBFS, attack ms, release ms
+            2f, 2f, 0f, 0f,          // Window: Blackman-Harris, keeps bass out of the finger bins
+            3f, 0f, 0f, 0f,          // FFT, automatic size
+            4f, 200f, 50f, 50f,      // Bands: low/high sensitivity, cap
+            5f, 0.7f, 0f, 0f,        // Smoothing
+            7f, 1f, 0.5f, 0.1f       // Noise: oversubtraction, extra at highway speed, spectral floor
+        )
+        private const val STAT_ANALYZER = 6
+        private const val STAT_INPUT_GAIN_MILLI = 7
+        private const val STAT_HOP_SIZE = 8 // SPECTRUM_HOP_SIZE, or the stream's burst size if that is longer
+
+        // pollBeatEvents layout: {type, bpm, strength} per event, see BeatTracker.h
+        private const val BEAT_EVENT_BATCH = 16
+        // Without the shared buffer the events cost a JNI call; poll them every
+        // few band polls, the native queue holds several seconds of them
+        private const val BEAT_POLL_INTERVAL = 5
+        private const val BEAT_EVENT_BEAT = 2
+
+        // Native EngineState, see AudioEngine.cpp
+        private const val ENGINE_STARTING = 1
+        private const val ENGINE_RUNNING = 2
+        private const val ENGINE_FAILED = 3
+        private const val ENGINE_DISCONNECTED = 5
         init {
             System.loadLibrary("native-lib")
         }
     }
 
-    private external fun startAudioEngine(instance: Long, ptr: LongArray): Long
-    private external fun stopAudioEngine(instance: Long, ptr: Long)
-    private external fun updateFrequencies(instance: Long, ptr: Long, lowFreq: FloatArray, highFreq: FloatArray)
+    private external fun startAudioEngine(instance: Long, handle: LongArray, analyzer: Int): Long
+    private external fun stopAudioEngine(instance: Long, handle: Long)
+    private external fun getBandFrame(instance: Long, handle: Long, frame: FloatArray)
+    private external fun setAnalysisWorker(instance: Long, handle: Long, enabled: Boolean, priority: Int, cpuMask: Long): Boolean
+    private external fun getPipelineStats(instance: Long, handle: Long, stats: LongArray)
+    private external fun getEngineStats(instance: Long, handle: Long, stats: LongArray)
+    private external fun getEngineState(instance: Long, handle: Long): Int
+    private external fun pauseAudioEngine(instance: Long, handle: Long)
+    private external fun resumeAudioEngine(instance: Long, handle: Long)
+    private external fun setHopSize(instance: Long, handle: Long, hopSize: Int)
+    private external fun setAnalyzer(instance: Long, handle: Long, kind: Int): Boolean
+    private external fun setDspChain(instance: Long, handle: Long, descriptor: FloatArray): Boolean
+    private external fun setVehicleSpeed(instance: Long, handle: Long, metersPerSecond: Float)
+    private external fun pollBeatEvents(instance: Long, handle: Long, timestamps: LongArray, values: FloatArray): Int
+    private external fun registerSpectrumBuffer(instance: Long, handle: Long): ByteBuffer?
+    private external fun dumpTrace(instance: Long, handle: Long, maxEntries: Int): String?
+    private external fun getDspVariant(instance: Long, handle: Long): String?
 
     override fun onCreate(savedInstanceState: Bundle?) {
         super.onCreate(savedInstanceState)
@@ -555,19 +657,7 @@ class MainActivity : ComponentActivity(), SensorEventListener {
                 Color.Magenta, Color.Yellow, Color.Blue, Color.Green, Color.Red
             )
 
-            val minBin = 0
-            val maxBin = 278
-            val binRange = maxBin - minBin
-            val logBase = Math.pow(maxBin.toDouble() / 1.0, 1.0 / 4.0)
-
             for (i in 0 until totalFingers) {
-                val pairIndex = if (i < 5) i else (9 - i)
-                val binIndex = if (pairIndex == 0) {
-                    minBin
-                } else {
-                    (minBin + (binRange * (Math.pow(logBase, pairIndex.toDouble()) - 1) / (Math.pow(logBase, 4.0) - 1))).toInt()
-                }.coerceIn(minBin, maxBin)
-
                 val sensitivity = when (i) {
                     0, 9 -> 200f
                     1, 8 -> 250f
@@ -576,7 +666,8 @@ class MainActivity : ComponentActivity(), SensorEventListener {
                     4, 5 -> 400f
                     else -> 300f
                 }
-                val fingerHeight = (50f + highFreqData[binIndex] * sensitivity).coerceAtMost(maxFingerHeight)
+                // Log-spaced, mirrored bands are reduced natively
+                val fingerHeight = (50f + bandFrame[i] * sensitivity).coerceAtMost(maxFingerHeight)
                 val isLeft = i < 5
                 val fingerX = if (isLeft) {
                     centerX + animatedX - 80f - ((4 - i) * fingerSpacing)
@@ -600,16 +691,29 @@ class MainActivity : ComponentActivity(), SensorEventListener {
             }
 
             val maxLegHeight = 400f
-            val bassBin = 0
-            val legHeight = (20f + lowFreqData[bassBin] * 10f).coerceAtMost(maxLegHeight)
+            val bassLegHeight = (20f + bandFrame[BAND_LEG] * 10f).coerceAtMost(maxLegHeight)
+            // With a tempo lock the legs stomp on the beat, alternating, and ease off
+            // through it; without one they follow the bass as before
+            val beatKick = if (beatPhase >= 0f) (1f - beatPhase) * (1f - beatPhase) else 0f
+            val stompHeight = 20f + beatKick * (maxLegHeight - 20f)
+            val leftLegHeight = when {
+                beatPhase < 0f -> bassLegHeight
+                beatCount % 2 == 0 -> stompHeight
+                else -> 20f
+            }
+            val rightLegHeight = when {
+                beatPhase < 0f -> bassLegHeight
+                beatCount % 2 == 1 -> stompHeight
+                else -> 20f
+            }
             val leftLegX = centerX + animatedX - 20f
             val rightLegX = centerX + animatedX + 20f
             val legBaseY = centerY + 100f + animatedY
 
             drawLine(color = Color.Gray, start = Offset(centerX + animatedX, centerY + 100f + animatedY), end = Offset(leftLegX, legBaseY), strokeWidth = 5f)
             drawLine(color = Color.Gray, start = Offset(centerX + animatedX, centerY + 100f + animatedY), end = Offset(rightLegX, legBaseY), strokeWidth = 5f)
-            drawLine(color = Color.Black, start = Offset(leftLegX, legBaseY), end = Offset(leftLegX, legBaseY + legHeight), strokeWidth = 20f)
-            drawLine(color = Color.Black, start = Offset(rightLegX, legBaseY), end = Offset(rightLegX, legBaseY + legHeight), strokeWidth = 20f)
+            drawLine(color = Color.Black, start = Offset(leftLegX, legBaseY), end = Offset(leftLegX, legBaseY + leftLegHeight), strokeWidth = 20f)
+            drawLine(color = Color.Black, start = Offset(rightLegX, legBaseY), end = Offset(rightLegX, legBaseY + rightLegHeight), strokeWidth = 20f)
 
             val headEmoji = when {
                 bumpEffect > 300f -> "😮"
@@ -683,6 +787,10 @@ class MainActivity : ComponentActivity(), SensorEventListener {
                     latitude = location.latitude
                     longitude = location.longitude
                     speed = location.speed * 2.23694f
+                    if (audioEngineHandle != 0L) {
+                        // Road noise subtraction scales with speed; -1 tells the engine it is unknown
+                        setVehicleSpeed(hashCode().toLong(), audioEngineHandle, if (location.hasSpeed()) location.speed else -1f)
+                    }
                 }
             }
         }
@@ -699,56 +807,151 @@ class MainActivity : ComponentActivity(), SensorEventListener {
 
         stopAudioEngineSafe()
 
-        lowFreqData.fill(0f)
-        highFreqData.fill(0f)
+        bandFrame.fill(0f)
         lowFreqAvg = 0f
         highFreqPeak = 0f
         smoothedLowFreqAvg = 0f
         smoothedHighFreqPeak = 0f
-        Log.d(TAG, "Audio buffers reset: lowFreqData[0]=${lowFreqData[0]}, highFreqData[0]=${highFreqData[0]}")
+        beatPhase = -1f
+        Log.d(TAG, "Audio band frame reset")
 
-        val ptrArray = LongArray(1)
+        val handleArray = LongArray(1)
         Log.d(TAG, "Attempting to start AudioEngine with instance=${hashCode().toLong()}")
+        // Phones that measured too slow for the FFT on an earlier run start on a
+        // cheaper analyzer; the engine opens the stream in the format it wants
+        startAnalyzer = getSharedPreferences("CarBuddyPrefs", MODE_PRIVATE).getInt(PREF_ANALYZER, ANALYZER_FFT)
         try {
-            audioEnginePtr = startAudioEngine(hashCode().toLong(), ptrArray)
-            if (audioEnginePtr == 0L) {
-                Log.e(TAG, "Failed to start AudioEngine, ptr remains 0")
+            audioEngineHandle = startAudioEngine(hashCode().toLong(), handleArray, startAnalyzer)
+            if (audioEngineHandle == 0L) {
+                Log.e(TAG, "Failed to start AudioEngine, handle remains 0")
                 return
             }
-            Log.d(TAG, "AudioEngine started successfully, ptr=$audioEnginePtr, ptrArray[0]=${ptrArray[0]}")
+            // The stream opens on a native thread; these only configure the pipeline
+            Log.d(TAG, "AudioEngine starting, handle=$audioEngineHandle, handleArray[0]=${handleArray[0]}")
+            Log.d(TAG, "DSP kernels: ${getDspVariant(hashCode().toLong(), audioEngineHandle)}")
+            setHopSize(hashCode().toLong(), audioEngineHandle, SPECTRUM_HOP_SIZE)
+            if (!setDspChain(hashCode().toLong(), audioEngineHandle, dspChainDescriptor())) {
+                Log.w(TAG, "DSP chain rejected, falling back to the default chain")
+                setDspChain(hashCode().toLong(), audioEngineHandle, DEFAULT_DSP_CHAIN)
+            }
+            attachSpectrumBuffer(registerSpectrumBuffer(hashCode().toLong(), audioEngineHandle))
+            // Run the FFT on a native worker so the audio callback only copies PCM
+            if (!setAnalysisWorker(hashCode().toLong(), audioEngineHandle, true, -16, 0L)) {
+                Log.w(TAG, "Analysis worker unavailable, analysing in the audio callback")
+            }
         } catch (e: Exception) {
             Log.e(TAG, "Error starting AudioEngine: ${e.message}", e)
-            audioEnginePtr = 0L
+            audioEngineHandle = 0L
             return
         }
 
+        startPolling()
+    }
+
+    // Waits out an asynchronous (re)start; true once the engine is capturing
+    private suspend fun awaitEngineRunning(): Boolean {
+        var engineState = getEngineState(hashCode().toLong(), audioEngineHandle)
+        while (engineState == ENGINE_STARTING) {
+            delay(10)
+            engineState = getEngineState(hashCode().toLong(), audioEngineHandle)
+        }
+        when (engineState) {
+            ENGINE_RUNNING -> return true
+            ENGINE_FAILED -> Log.e(TAG, "AudioEngine failed to open the input stream")
+            else -> Log.d(TAG, "AudioEngine start cancelled (state $engineState)")
+        }
+        return false
+    }
+
+    private fun startPolling() {
         if (!::audioScope.isInitialized || !audioScope.isActive) {
             audioScope = CoroutineScope(Dispatchers.Default + SupervisorJob())
             Log.d(TAG, "Initialized new audioScope for audio processing")
         }
 
-        audioScope.launch {
-            delay(500)
-            var prevLowFreqAvg = 0f
-            var prevHighFreqPeak = 0f
-            val smoothingFactor = 0.7f
+        audioJob = audioScope.launch {
+            if (!awaitEngineRunning()) return@launch
+            val pipelineStats = LongArray(PIPELINE_STAT_COUNT)
+            val engineStats = LongArray(ENGINE_STAT_COUNT)
+            var pollCount = 0
+            var hopSizeLogged = false
             Log.d(TAG, "Audio processing coroutine started")
-            while (isActive && audioEnginePtr != 0L) {
+            while (isActive && audioEngineHandle != 0L) {
                 try {
-                    if (audioEnginePtr != 0L) { // Double-check engine state
-                        Log.d(TAG, "Calling updateFrequencies with ptr=$audioEnginePtr")
-                        updateFrequencies(hashCode().toLong(), audioEnginePtr, lowFreqData, highFreqData)
-                        lowFreqAvg = lowFreqData.map { abs(it) }
-                            .filter { it.isFinite() && it <= 1000f }
-                            .takeIf { it.isNotEmpty() }?.average()?.toFloat() ?: 0f
-                        highFreqPeak = highFreqData.map { abs(it) }
-                            .filter { it.isFinite() && it <= 1000f }
-                            .takeIf { it.isNotEmpty() }?.maxOrNull() ?: 0f
-                        smoothedLowFreqAvg = (smoothingFactor * prevLowFreqAvg) + ((1f - smoothingFactor) * lowFreqAvg)
-                        smoothedHighFreqPeak = (smoothingFactor * prevHighFreqPeak) + ((1f - smoothingFactor) * highFreqPeak)
-                        prevLowFreqAvg = smoothedLowFreqAvg
-                        prevHighFreqPeak = smoothedHighFreqPeak
+                    if (audioEngineHandle != 0L) { // Double-check engine state
+                        val buffer = spectrumBuffer
+                        var events = 0
+                        if (buffer != null) {
+                            readSharedBands(buffer)
+                            events = sharedBeatEvents
+                        } else {
+                            getBandFrame(hashCode().toLong(), audioEngineHandle, bandFrame)
+                            if (pollCount % BEAT_POLL_INTERVAL == 0) {
+                                events = pollBeatEvents(hashCode().toLong(), audioEngineHandle, beatTimes, beatValues)
+                            }
+                        }
+                        lowFreqAvg = bandFrame[BAND_LOW_AVG]
+                        highFreqPeak = bandFrame[BAND_HIGH_PEAK]
+                        smoothedLowFreqAvg = bandFrame[BAND_SMOOTHED_LOW_AVG]
+                        smoothedHighFreqPeak = bandFrame[BAND_SMOOTHED_HIGH_PEAK]
+                        beatPhase = bandFrame[BAND_BEAT_PHASE]
+                        for (i in 0 until events) {
+                            if (beatValues[i * 3].toInt() == BEAT_EVENT_BEAT) {
+                                beatCount++
+                                beatBpm = beatValues[i * 3 + 1]
+                            }
+                        }
                         Log.d("AudioDebug", "LowFreqAvg: $lowFreqAvg, HighFreqPeak: $highFreqPeak")
+                        if (pollCount % 20 == 0 && getEngineState(hashCode().toLong(), audioEngineHandle) == ENGINE_DISCONNECTED) {
+                            // Headset or USB mic went away; reopen on whatever input is there now
+                            Log.w(TAG, "Audio input disconnected, reopening")
+                            resumeAudioEngine(hashCode().toLong(), audioEngineHandle)
+                            if (!awaitEngineRunning()) break
+                        }
+                        if (++pollCount % 100 == 0) {
+                            getPipelineStats(hashCode().toLong(), audioEngineHandle, pipelineStats)
+                            Log.d("AudioDebug", "Callback ${pipelineStats[0] / 1000}us (max ${pipelineStats[1] / 1000}us), " +
+                                    "worker lag ${pipelineStats[2] / 1000}us (max ${pipelineStats[3] / 1000}us), " +
+                                    "ring overruns ${pipelineStats[4]}, mode ${pipelineStats[5]}, analyzer ${pipelineStats[STAT_ANALYZER]}, " +
+                                    "input gain ${"%.2f".format(pipelineStats[STAT_INPUT_GAIN_MILLI] / 1000f)}, " +
+                                    "hop ${pipelineStats[STAT_HOP_SIZE]}, " +
+                                    "tempo ${"%.1f".format(beatBpm)} BPM after $beatCount beats")
+                            val hopSize = pipelineStats[STAT_HOP_SIZE]
+                            if (!hopSizeLogged && hopSize > 0) {
+                                if (hopSize != SPECTRUM_HOP_SIZE.toLong()) {
+                                    Log.i(TAG, "Spectrum hop is $hopSize samples instead of $SPECTRUM_HOP_SIZE: " +
+                                            "the stream delivers longer bursts")
+                                }
+                                hopSizeLogged = true
+                            }
+                            getEngineStats(hashCode().toLong(), audioEngineHandle, engineStats)
+                            Log.d("AudioDebug", "Callback p50/p99/max ${formatMicros(engineStats, HIST_CALLBACK_NS)}, " +
+                                    "hop analysis ${formatMicros(engineStats, HIST_HOP_ANALYSIS_NS)}, " +
+                                    "burst ${engineStats[HIST_BURST_FRAMES]}/${engineStats[HIST_BURST_FRAMES + 1]}/${engineStats[HIST_BURST_FRAMES + 2]} frames, " +
+                                    "frame age ${formatMicros(engineStats, HIST_FRAME_AGE_NS)}, " +
+                                    "no-fresh polls ${engineStats[STAT_NO_FRESH_POLLS]}, stale reads ${engineStats[STAT_STALE_READS]}, " +
+                                    "xruns ${engineStats[STAT_XRUNS]}, " +
+                                    "first spectrum after ${engineStats[STAT_TIME_TO_FIRST_SPECTRUM_NS] / 1_000_000}ms")
+                            // The hop histogram runs from the start, so only the analyzer this run
+                            // started on is judged; one fallen back to is judged on the next run
+                            if (startAnalyzer != ANALYZER_ENVELOPE &&
+                                pipelineStats[STAT_ANALYZER] == startAnalyzer.toLong() &&
+                                engineStats[HIST_HOP_ANALYSIS_NS + 3] >= 100 &&
+                                engineStats[HIST_HOP_ANALYSIS_NS + 1] > HOP_ANALYSIS_BUDGET_NS) {
+                                // 32-bit ARM is where the fixed-point FFT pays; it captures I16 from the next start
+                                val fallback = if (startAnalyzer == ANALYZER_FFT && Build.SUPPORTED_64_BIT_ABIS.isEmpty()) {
+                                    ANALYZER_FIXED_FFT
+                                } else {
+                                    ANALYZER_ENVELOPE
+                                }
+                                Log.w(TAG, "Hop analysis p99 ${engineStats[HIST_HOP_ANALYSIS_NS + 1] / 1000}us over budget, " +
+                                        "switching from analyzer $startAnalyzer to $fallback")
+                                if (setAnalyzer(hashCode().toLong(), audioEngineHandle, fallback)) {
+                                    getSharedPreferences("CarBuddyPrefs", MODE_PRIVATE).edit()
+                                        .putInt(PREF_ANALYZER, fallback).apply()
+                                }
+                            }
+                        }
                     }
                 } catch (e: Exception) {
                     Log.e(TAG, "Error in audio update loop: ${e.message}", e)
@@ -759,22 +962,134 @@ class MainActivity : ComponentActivity(), SensorEventListener {
         }
     }
 
+    private fun dspChainDescriptor(): FloatArray {
+        val custom = getSharedPreferences("CarBuddyPrefs", MODE_PRIVATE).getString(PREF_DSP_CHAIN, null)
+            ?: return DEFAULT_DSP_CHAIN
+        return custom.split(',').mapNotNull { it.trim().toFloatOrNull() }.toFloatArray()
+    }
+
+    private fun formatMicros(stats: LongArray, histogram: Int): String =
+        "${stats[histogram] / 1000}/${stats[histogram + 1] / 1000}/${stats[histogram + 2] / 1000}us"
+
+    private fun attachSpectrumBuffer(buffer: ByteBuffer?) {
+        if (buffer == null) {
+            Log.w(TAG, "Shared spectrum buffer unavailable, falling back to getBandFrame")
+            return
+        }
+        buffer.order(ByteOrder.nativeOrder())
+        if (buffer.capacity() < SHARED_SPECTRUM_OFFSET) {
+            Log.e(TAG, "Shared spectrum buffer too small: ${buffer.capacity()} bytes")
+            return
+        }
+        val eventsOffset = SHARED_SPECTRUM_OFFSET + 4 * (buffer.getInt(4) + buffer.getInt(8))
+        val eventCapacity = if (buffer.capacity() >= eventsOffset + 8) buffer.getInt(eventsOffset + 4) else 0
+        if (eventCapacity <= 0 || buffer.capacity() < eventsOffset + 8 + SHARED_EVENT_BYTES * eventCapacity) {
+            Log.e(TAG, "Shared spectrum buffer too small: ${buffer.capacity()} bytes")
+            return
+        }
+        sharedEventsOffset = eventsOffset
+        sharedEventCapacity = eventCapacity
+        lastEventsWritten = 0
+        bandView = buffer.duplicate().order(ByteOrder.nativeOrder()).apply { position(SHARED_BAND_OFFSET) }
+            .slice().order(ByteOrder.nativeOrder()).asFloatBuffer()
+        lastSpectrumSequence = -1
+        spectrumBuffer = buffer
+    }
+
+    // Keeps the reads on either side of it in order, the Kotlin half of the
+    // native writer's release stores. VarHandle fences need API 33; below that
+    // a volatile write then a volatile read is the same barrier under the JMM.
+    private fun loadFence() {
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.TIRAMISU) {
+            VarHandle.acquireFence()
+        } else {
+            fenceWord = 0
+            if (fenceWord != 0) fenceWord = 0
+        }
+    }
+
+    // Sequence-lock read of the latest band frame and the beat events published
+    // since the last read (into beatTimes / beatValues, sharedBeatEvents of them);
+    // returns true if a new frame was copied
+    private fun readSharedBands(buffer: ByteBuffer): Boolean {
+        val bands = bandView ?: return false
+        sharedBeatEvents = 0
+        repeat(3) {
+            val before = buffer.getInt(0)
+            if (before and 1 != 0) return@repeat // Mid-publish, try again
+            if (before == lastSpectrumSequence) return false
+            loadFence() // The bands are read after the sequence...
+            bands.position(0)
+            bands.get(bandFrame)
+            val written = buffer.getInt(sharedEventsOffset)
+            // Unsigned counters; only the newest events if more came than fit
+            val count = (written - lastEventsWritten).coerceIn(0, min(sharedEventCapacity, BEAT_EVENT_BATCH))
+            for (i in 0 until count) {
+                val slot = ((written - count + i).toLong() and 0xffffffffL) % sharedEventCapacity
+                val at = sharedEventsOffset + 8 + SHARED_EVENT_BYTES * slot.toInt()
+                beatTimes[i] = buffer.getLong(at)
+                beatValues[i * 3] = buffer.getInt(at + 8).toFloat()
+                beatValues[i * 3 + 1] = buffer.getFloat(at + 12)
+                beatValues[i * 3 + 2] = buffer.getFloat(at + 16)
+            }
+            loadFence() // ...and before it is read again
+            if (buffer.getInt(0) == before) {
+                lastSpectrumSequence = before
+                lastEventsWritten = written
+                sharedBeatEvents = count
+                return true
+            }
+        }
+        return false
+    }
+
+    // Keeps the engine, its stream and the shared buffer; resumeAudio() restarts capture warm
+    private fun pauseAudio() {
+        audioJob?.let { job -> runBlocking { job.cancelAndJoin() } }
+        audioJob = null
+        if (audioEngineHandle != 0L) {
+            pauseAudioEngine(hashCode().toLong(), audioEngineHandle)
+            Log.d(TAG, "AudioEngine paused, handle=$audioEngineHandle")
+        }
+    }
+
+    private fun resumeAudio() {
+        if (ContextCompat.checkSelfPermission(this, Manifest.permission.RECORD_AUDIO) != PackageManager.PERMISSION_GRANTED) {
+            Log.w(TAG, "Record audio permission not granted, skipping audio resume")
+            return
+        }
+        if (audioEngineHandle == 0L) {
+            setupAudio()
+            return
+        }
+        if (audioJob?.isActive == true) return
+        resumeAudioEngine(hashCode().toLong(), audioEngineHandle)
+        startPolling()
+    }
+
     private fun stopAudioEngineSafe() {
         if (::audioScope.isInitialized && audioScope.isActive) {
             audioScope.cancel("Audio engine stopping")
             Log.d(TAG, "audioScope canceled during stopAudioEngineSafe")
         }
-        if (audioEnginePtr != 0L) {
-            Log.d(TAG, "Safely stopping AudioEngine, ptr=$audioEnginePtr")
+        // The poller must be done with the shared buffer before the engine frees it
+        audioJob?.let { job -> runBlocking { job.cancelAndJoin() } }
+        audioJob = null
+        spectrumBuffer = null
+        bandView = null
+        if (audioEngineHandle != 0L) {
+            Log.d(TAG, "Safely stopping AudioEngine, handle=$audioEngineHandle")
+            // Recent native trace (spectra, JNI transfers, overruns) for post-mortem debugging
+            dumpTrace(hashCode().toLong(), audioEngineHandle, 32)?.let { Log.d("AudioTrace", it) }
             try {
-                stopAudioEngine(hashCode().toLong(), audioEnginePtr)
+                stopAudioEngine(hashCode().toLong(), audioEngineHandle)
                 Log.d(TAG, "AudioEngine stopped successfully")
             } catch (e: Exception) {
                 Log.e(TAG, "Error stopping AudioEngine: ${e.message}", e)
             }
-            audioEnginePtr = 0L
+            audioEngineHandle = 0L
         } else {
-            Log.d(TAG, "No AudioEngine to stop (ptr=0)")
+            Log.d(TAG, "No AudioEngine to stop (handle=0)")
         }
     }
 
@@ -953,10 +1268,9 @@ class MainActivity : ComponentActivity(), SensorEventListener {
         if (ContextCompat.checkSelfPermission(this, Manifest.permission.ACCESS_FINE_LOCATION) == PackageManager.PERMISSION_GRANTED) {
             fusedLocationClient.removeLocationUpdates(locationCallback)
         }
-        stopAudioEngineSafe()
-        lowFreqData.fill(0f)
-        highFreqData.fill(0f)
-        Log.d(TAG, "onPause: Audio stopped, buffers reset")
+        pauseAudio()
+        bandFrame.fill(0f)
+        Log.d(TAG, "onPause: Audio paused, engine kept warm")
     }
 
     override fun onResume() {
@@ -983,7 +1297,7 @@ class MainActivity : ComponentActivity(), SensorEventListener {
             Log.w(TAG, "RECORD_AUDIO permission not granted on resume, requesting again")
             requestPermissions()
         } else {
-            setupAudio()
+            resumeAudio()
         }
 
         setupSensors()
@@ -996,8 +1310,7 @@ class MainActivity : ComponentActivity(), SensorEventListener {
                 null
             )
         }
-        lowFreqData.fill(0f)
-        highFreqData.fill(0f)
+        bandFrame.fill(0f)
         Log.d(TAG, "onResume: Setup audio completed")
     }
 
@@ -1010,7 +1323,7 @@ class MainActivity : ComponentActivity(), SensorEventListener {
         if (ContextCompat.checkSelfPermission(this, Manifest.permission.ACCESS_FINE_LOCATION) == PackageManager.PERMISSION_GRANTED) {
             fusedLocationClient.removeLocationUpdates(locationCallback)
         }
-        stopAudioEngineSafe()
+        pauseAudio()
     }
 
     override fun onDestroy() {